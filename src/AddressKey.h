@@ -0,0 +1,184 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ADDRESS_KEY_H
+#define _ADDRESS_KEY_H
+
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/**
+ * Binary identification of a tracked source: IPv6 address (IPv4 addresses
+ * are IPv4-mapped) and a source port (0 if ports are not distinguished).
+ * The key is cheap to compare and hash, text form is created only for output.
+ */
+struct AddressKey {
+  /// IPv6 or IPv4-mapped IPv6 address in the network byte order
+  uint8_t addr[16];
+  /// Source port in the host byte order
+  uint16_t port;
+
+  AddressKey(): port(0)
+  {
+    std::memset(addr, 0, sizeof(addr));
+  }
+
+  /**
+   * Creates a key of an IPv4 source
+   * @param[in] ip IPv4 address
+   * @param[in] port Source port, 0 if not distinguished
+   */
+  static AddressKey FromIPv4(const struct in_addr &ip, uint16_t port = 0)
+  {
+    AddressKey key;
+    key.addr[10] = 0xff;
+    key.addr[11] = 0xff;
+    std::memcpy(key.addr + 12, &ip, 4);
+    key.port = port;
+    return key;
+  }
+
+  /**
+   * Creates a key of an IPv6 source
+   * @param[in] ip IPv6 address
+   * @param[in] port Source port, 0 if not distinguished
+   */
+  static AddressKey FromIPv6(const struct in6_addr &ip, uint16_t port = 0)
+  {
+    AddressKey key;
+    std::memcpy(key.addr, &ip, 16);
+    key.port = port;
+    return key;
+  }
+
+  /**
+   * Parses the text form created by ToString()
+   * @param[in] text IP address, optionally followed by _port
+   * @param[out] key Parsed key
+   * @return true if the text was parsed
+   */
+  static bool Parse(const std::string &text, AddressKey &key)
+  {
+    std::string ip = text;
+    key = AddressKey();
+    std::string::size_type sep = text.rfind('_');
+    if (sep != std::string::npos) {
+      char *end;
+      unsigned long port = std::strtoul(text.c_str() + sep + 1, &end, 10);
+      if (*end != '\0' || port > 0xffff)
+        return false;
+      key.port = port;
+      ip = text.substr(0, sep);
+    }
+    struct in_addr ip4;
+    struct in6_addr ip6;
+    if (inet_pton(AF_INET, ip.c_str(), &ip4) == 1) {
+      key = FromIPv4(ip4, key.port);
+      return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), &ip6) == 1) {
+      key = FromIPv6(ip6, key.port);
+      return true;
+    }
+    return false;
+  }
+
+  /// Returns true for IPv4-mapped addresses
+  bool IsIPv4() const
+  {
+    static const uint8_t prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    return std::memcmp(addr, prefix, sizeof(prefix)) == 0;
+  }
+
+  /// Returns the key without the port
+  AddressKey WithoutPort() const
+  {
+    AddressKey key = *this;
+    key.port = 0;
+    return key;
+  }
+
+  /// Text form of the IP address (dotted quad for IPv4)
+  std::string IpString() const
+  {
+    // IPv6 addr length (39B) + '\0' + some padding
+    char buffer[64];
+    if (IsIPv4()) {
+      inet_ntop(AF_INET, addr + 12, buffer, sizeof(buffer));
+    }
+    else {
+      inet_ntop(AF_INET6, addr, buffer, sizeof(buffer));
+    }
+    return buffer;
+  }
+
+  /**
+   * Text form of the key
+   * @param[in] withPort Append _port to the IP address
+   */
+  std::string ToString(bool withPort) const
+  {
+    if (!withPort)
+      return IpString();
+    std::stringstream buffer;
+    buffer << IpString() << '_' << port;
+    return buffer.str();
+  }
+
+  bool operator==(const AddressKey &other) const
+  {
+    return port == other.port && std::memcmp(addr, other.addr, sizeof(addr)) == 0;
+  }
+
+  bool operator!=(const AddressKey &other) const
+  {
+    return !(*this == other);
+  }
+
+  /// FNV-1a hash of the address and the port
+  size_t Hash() const
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < sizeof(addr); i++) {
+      hash = (hash ^ addr[i]) * 1099511628211ULL;
+    }
+    hash = (hash ^ (port & 0xff)) * 1099511628211ULL;
+    hash = (hash ^ (port >> 8)) * 1099511628211ULL;
+    return hash;
+  }
+};
+
+namespace std {
+  template <>
+  struct hash<AddressKey> {
+    size_t operator()(const AddressKey &key) const
+    {
+      return key.Hash();
+    }
+  };
+}
+
+#endif
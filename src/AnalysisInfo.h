@@ -35,6 +35,7 @@ class AnalysisInfo {
 public:
   const std::string& Address;
   identity_container SimilarIdentities;
+  /// Shares atoms with the skew of the computer, it is not copied
   const TimeSegmentList ClockSkewList;
 };
 #endif
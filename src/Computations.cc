@@ -28,42 +28,22 @@
 #include "Computations.h"
 #include "Configurator.h"
 
-void Computations::SwapPoints(Point *x, Point *y) {
-   Point tmp;
-   tmp = *x;
-   *x = *y;
-   *y = tmp;
-}
-
 double Computations::CounterClockwiseTest(Point p1, Point p2, Point p3) {
   return((p2.x - p1.x) * (p3.y - p1.y) - (p2.y - p1.y) * (p3.x - p1.x));
 }
 
 // More details in:
-// Graham, R. L.: An efficient algorithm for determining the convex hull of a finite
-// planar set. Information Processing Letters, vol. 1, no. 4, jan 1972: pp. 132–133,
+// Andrew, A. M.: Another efficient algorithm for convex hulls in two dimensions.
+// Information Processing Letters, vol. 9, no. 5, dec 1979: pp. 216–219,
 // ISSN 0020-0190.
-Point * Computations::ConvexHull(Point points[], unsigned long *number)
+void Computations::AddToUpperHull(std::vector<Point> &hull, const Point &point)
 {
-  unsigned long i;
-  int m = 1;
-  
-  for (i = 2; i < *number; i++) {
-    while (i <= *number && Computations::CounterClockwiseTest(points[m - 1], points[m], points[i]) >= 0) {
-      if (m == 1) {
-        Computations::SwapPoints(&points[m], &points[i]);
-        i++;
-      }
-      else
-        m--;
-    }
-    m++;
-    Computations::SwapPoints(&points[m], &points[i]);
+  // Remove points that are below or on the line from their predecessor to the new point
+  while (hull.size() >= 2 &&
+      Computations::CounterClockwiseTest(hull[hull.size() - 2], hull.back(), point) >= 0) {
+    hull.pop_back();
   }
-  
-  *number = ++m;
-  
-  return(points);
+  hull.push_back(point);
 }
 
 
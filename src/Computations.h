@@ -24,15 +24,10 @@
 #include "PacketTimeInfo.h"
 
 #include <string>
+#include <vector>
 
 class Computations {
 public:
-/**
- * Swap two points
- * @param[in] x, @param[in] y Points
- */
-static void SwapPoints(Point *x, Point *y);
-
 /**
  * Counter-clockwise test
  * 
@@ -52,14 +47,12 @@ static double CounterClockwiseTest(Point p1, Point p2, Point p3);
 static void SetOffset(PacketTimeInfo &packet, const PacketTimeInfo &head, int freq);
 
 /**
- * Compute upper bound as a upper convex hull. Graham scan algorithm is used.
- * Note that the input list with points is destroyed during the process and
- * the function returns a pointer to the input list.
- * @param[in] points Points list
- * @param[in,out] number List size
- * @return Pointer to list with convex hull points
+ * Adds a point to an upper convex hull (monotone chain). Points have to be
+ * added sorted by x, the hull is updated in amortized constant time.
+ * @param[in,out] hull Points of the upper convex hull
+ * @param[in] point New point with x not lower than x of all points in hull
  */
-static Point * ConvexHull(Point points[], unsigned long *number);
+static void AddToUpperHull(std::vector<Point> &hull, const Point &point);
 
 /**
  * Conversts a part of a string to long long
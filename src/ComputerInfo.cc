@@ -19,14 +19,16 @@
  * along with pcf. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <cassert>
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <list>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <utility>
 #include <fstream>
+#include <vector>
 
 #include "ComputerInfoList.h"
 #include "TimeSegment.h"
@@ -37,33 +39,31 @@
 #include "Configurator.h"
 #include "ComputerInfo.h"
 #include "check_computers.h"
+#include "PacketLog.h"
+#include "OutputQueue.h"
 
 const double SKEW_VALID_AFTER = 5 * 60;
-
-ComputerInfo::ComputerInfo(void * parentList, const char* its_address, uint16_t its_port) :
-packets(), freq(Configurator::instance()->setFreq), confirmedSkew(UNDEFINED_SKEW, UNDEFINED_SKEW), packetSegmentList(),
-ipAddress(its_address), port(its_port), variance(0), avg(0), numOfPackets(0), sum1(0), sum2(0),
-oneMoreHour(0), firstPacketReceived(false) {
+/// Pending log records are saved when they reach this size (bytes)
+const size_t PENDING_LOG_LIMIT = 1 << 16;
+
+ComputerInfo::ComputerInfo(void * parentList, const AddressKey &its_key) :
+packets(), pendingLog(), logCreated(false), freq(Configurator::instance()->setFreq), frequencyEstimator(), lastPacketTime(0), confirmedSkew(UNDEFINED_SKEW, UNDEFINED_SKEW), packetSegmentList(),
+key(its_key), address(its_key.ToString(Configurator::instance()->portEnable)),
+variance(0), avg(0), numOfPackets(0), sum1(0), sum2(0),
+oneMoreHour(0), firstPacketReceived(false), skewVersion(0), summary(), activeFragment(), stateSlot(-1) {
   this->parentList = parentList;
-  if (!Configurator::instance()->portEnable) {
-    address = ipAddress;
-  } else {
-    std::stringstream buffer;
-    buffer << ipAddress << '_' << port;
-    address = buffer.str();
-  }
 }
 
 void ComputerInfo::output_skewbypacket_results(double skew) {
   variance = (preliminarySum2 - (preliminarySum1 * preliminarySum1) / preliminaryNumOfPackets) / (preliminaryNumOfPackets);
   if(Configurator::instance()->outFile != "" && (oneMoreHour != 0)) {
-    std::ofstream resultFile;
-    resultFile.open(Configurator::instance()->outFile, std::ofstream::app);
+    std::ostringstream resultFile;
     std::string type = static_cast<ComputerInfoList *> (parentList)->getOutputDirectory();
     type.resize(type.size() - 1);
     resultFile << address << "\t" << type << "\t" << freq << "\t" << Configurator::instance()->setSkew << "\t" <<
         computedSkew << "\t" << skew << "\t" << preliminaryNumOfPackets << "\t" <<
         oneMoreHour - startTime << "\t" << preliminaryAverage << "\t" << variance << "\t" << sqrt(variance) << std::endl;
+    OutputQueue::instance()->Append(Configurator::instance()->outFile, resultFile.str());
   }
   else {
     std::cout << "target skew:\t\t" << Configurator::instance()->setSkew << std::endl;
@@ -91,7 +91,7 @@ void ComputerInfo::insert_first_packet(double packet_delivered, uint64_t timesta
   previousPacketTime = startTime;
 
   insert_packet(packet_delivered, timestamp);
-  add_empty_packet_segment(packets.begin());
+  add_empty_packet_segment(0);
 }
 
 void ComputerInfo::insert_packet(double packet_delivered, uint64_t timestamp) { // This method shouldn't suppose that skew_list contain valid information
@@ -101,9 +101,26 @@ void ComputerInfo::insert_packet(double packet_delivered, uint64_t timestamp) {
   new_packet.Timestamp = timestamp;
 
   packets.push_back(new_packet);
+
+  if (packets.size() == 1) {
+    PacketLog::AddStart(pendingLog, packet_delivered, freq);
+  }
+  PacketLog::AddSample(pendingLog, packet_delivered, timestamp);
+  if (pendingLog.size() >= PENDING_LOG_LIMIT) {
+    save_packets();
+  }
   
-  if (freq != 0) {
-    Computations::SetOffset(*(packets.rbegin()), *(packets.begin()), freq);
+  if (freq == 0) {
+    const PacketTimeInfo &first = packets.front();
+    frequencyEstimator.add(new_packet.ArrivalTime - first.ArrivalTime, new_packet.Timestamp - first.Timestamp);
+  }
+  else {
+    Computations::SetOffset(packets.back(), packets.front(), freq);
+    if (!packetSegmentList.empty()) {
+      PacketSegment &segment = packetSegmentList.back();
+      segment.sums.add(packets.back().Offset);
+      Computations::AddToUpperHull(segment.hull, packets.back().Offset);
+    }
   }
 
   lastPacketTime = packet_delivered;
@@ -130,22 +147,20 @@ bool ComputerInfo::check_block_finish(double packet_delivered) {
 void ComputerInfo::recompute_block(double packet_delivered) {
   // Set frequency
   if (freq == 0) {
-    if ((packet_delivered - startTime) < 60) {
-      return;
-    } else {
-      freq = compute_freq();
+    freq = compute_freq(packet_delivered);
 #if 0
-      fprintf(stderr, "Found %s with frequency %d", address.c_str(), freq);
+    fprintf(stderr, "Found %s with frequency %d", address.c_str(), freq);
 #endif
 
-      const PacketTimeInfo &first = *(packets.begin());
-      if (freq != 0) {
-        for (packetTimeInfoList::iterator it = packets.begin(); it != packets.end(); ++it) {
-          Computations::SetOffset(*it, first, freq);
-        }
-      } else {
-        return;
+    const PacketTimeInfo &first = packets.front();
+    if (freq != 0) {
+      for (packet_index i = 0; i < packets.size(); ++i) {
+        Computations::SetOffset(packets[i], first, freq);
       }
+      PacketLog::AddFrequency(pendingLog, freq);
+      update_segment(packetSegmentList.back());
+    } else {
+      return;
     }
   }
   /// Save Offsets into file
@@ -154,14 +169,15 @@ void ComputerInfo::recompute_block(double packet_delivered) {
 
   /// Recompute skew for graph
   PacketSegment &last_skew = *packetSegmentList.rbegin();
-  ClockSkewPair new_skew = compute_skew(last_skew.first, packets.end());
+  ClockSkewPair new_skew = compute_skew(last_skew.hull, last_skew.sums);
   
   if(Configurator::instance()->setFreq != 0){
-    std::ofstream outfile;
-    std::string type = static_cast<ComputerInfoList *> (parentList)->getOutputDirectory();
-    type.resize(type.size() - 1);
-    outfile.open("log/" + address + "-" + type + ".dat", std::ofstream::app);
-    outfile << packet_delivered - startTime << "\t" << new_skew.Alpha << std::endl;
+    std::ostringstream line;
+    line << packet_delivered - startTime << "\t" << new_skew.Alpha << '\n';
+    skewLog += line.str();
+    if (skewLog.size() >= PENDING_LOG_LIMIT) {
+      flush_skew_log();
+    }
   }
 
   if (Configurator::instance()->setFreq != 0 &&
@@ -180,7 +196,7 @@ void ComputerInfo::recompute_block(double packet_delivered) {
 #ifdef DEBUG
     fprintf(stderr, "Clock skew not set for %s\n", address.c_str());
 #endif
-    add_empty_packet_segment(--packets.end());
+    add_empty_packet_segment(packets.size() - 1);
     confirmedSkew.Alpha = UNDEFINED_SKEW;
     confirmedSkew.Beta = UNDEFINED_SKEW;
     lastConfirmedPacketTime = packet_delivered;
@@ -214,6 +230,8 @@ void ComputerInfo::recompute_block(double packet_delivered) {
       } else {
         if ((packet_delivered - oneMoreHour) > 3600) {
 					output_skewbypacket_results(new_skew.Alpha);
+          flush_skew_log();
+          OutputQueue::instance()->Flush();
           exit(EXIT_SUCCESS);
         }
       }
@@ -228,7 +246,9 @@ void ComputerInfo::recompute_block(double packet_delivered) {
 
   if (((packet_delivered - lastConfirmedPacketTime) > SKEW_VALID_AFTER) &&
         (Configurator::instance()->setFreq == 0)) {
-    ClockSkewPair last_skew_pair = compute_skew(last_skew.confirmed, packets.end());
+    std::vector<Point> confirmed_hull;
+    upper_hull(last_skew.confirmed, packets.size(), confirmed_hull);
+    ClockSkewPair last_skew_pair = compute_skew(confirmed_hull, last_skew.sums - last_skew.confirmedSums);
     if ((std::fabs(last_skew_pair.Alpha - confirmedSkew.Alpha) < 10 * Configurator::instance()->threshold) ||
         (std::isnan(confirmedSkew.Alpha))) {
       // New skew confirmed
@@ -237,22 +257,33 @@ void ComputerInfo::recompute_block(double packet_delivered) {
       last_skew.confirmedAlpha = new_skew.Alpha;
       last_skew.confirmedBeta = new_skew.Beta;
       last_skew.confirmed = last_skew.last;
-      last_skew.last = --packets.end();
+      last_skew.confirmedSums = last_skew.lastSums;
+      last_skew.last = packets.size() - 1;
+      last_skew.lastSums = last_skew.sums;
+      last_skew.lastSums.x -= packets.back().Offset.x;
+      last_skew.lastSums.y -= packets.back().Offset.y;
+      last_skew.lastSums.count--;
       lastConfirmedPacketTime = packet_delivered;
 #ifdef DEBUG
       printf("%s: New skew confirmed (%g, %g), time %g\n", address.c_str(),
-          confirmedSkew.Alpha, confirmedSkew.Beta, last_skew.last->Offset.x);
+          confirmedSkew.Alpha, confirmedSkew.Beta, packets[last_skew.last].Offset.x);
 #endif
-      if (Configurator::instance()->reduce)
-        if (packets.size() > (unsigned int) (Configurator::instance()->block * 15))
+      if (Configurator::instance()->retainHullOnly)
+        retain_hull_packets(false);
+      else if (Configurator::instance()->reduce)
+        if (packets.size() > (unsigned int) (Configurator::instance()->block * 15)) {
           reduce_packets(last_skew.first, last_skew.confirmed);
+          update_segment(last_skew);
+        }
     } else {
       find_jump_point();
-      add_empty_packet_segment(--packets.end());
+      add_empty_packet_segment(packets.size() - 1);
       confirmedSkew.Alpha = UNDEFINED_SKEW;
       confirmedSkew.Beta = UNDEFINED_SKEW;
       lastConfirmedPacketTime = packet_delivered;
-      if (Configurator::instance()->reduce)
+      if (Configurator::instance()->retainHullOnly)
+        retain_hull_packets(false);
+      else if (Configurator::instance()->reduce)
         reduce_packets(last_skew.first, last_skew.last);
     }
   }
@@ -261,18 +292,20 @@ void ComputerInfo::recompute_block(double packet_delivered) {
   for (std::list<PacketSegment>::iterator it = packetSegmentList.begin(); it != packetSegmentList.end(); ++it) {
     TimeSegment atom = {
       it->confirmedAlpha, it->confirmedBeta,
-      (it->first)->Offset.x + get_start_time(),
-      (it->last)->Offset.x + get_start_time(),
+      packets[it->first].Offset.x + get_start_time(),
+      packets[it->last].Offset.x + get_start_time(),
       // relative start and end time
-      (it->first)->Offset.x,
-      (it->last)->Offset.x
+      packets[it->first].Offset.x,
+      packets[it->last].Offset.x
     };
     if (!std::isnan(atom.alpha) && !std::isnan(atom.beta)) {
       s.add_atom(atom);
     }
   }
-  s.set_end_time(packets.rbegin()->Offset.x + get_start_time());
-  NewTimeSegmentList = s;
+  s.set_end_time(packets.back().Offset.x + get_start_time());
+  // Only the reference to the atoms is moved, observers may still share the
+  // atoms of the previous skew
+  NewTimeSegmentList = std::move(s);
 }
 
 bool ComputerInfo::find_jump_point() {
@@ -281,79 +314,186 @@ bool ComputerInfo::find_jump_point() {
   }
 
   PacketSegment &last_skew = *packetSegmentList.rbegin();
-  packet_iterator final_point = last_skew.last;
-  for (packet_iterator it = last_skew.last; it != packets.end(); ++it) {
-    double min_y = (last_skew.confirmedAlpha-0.001) * it->Offset.x + last_skew.confirmedBeta;
-    double max_y = (last_skew.confirmedAlpha+0.001) * it->Offset.x + last_skew.confirmedBeta;
-    if ((it->Offset.y > min_y) && (it->Offset.y < max_y)) {
-      final_point = it;
+  packet_index final_point = last_skew.last;
+  // Sums of offsets of packets [last, i) and [last, final_point)
+  OffsetSums walked, final_sums;
+  for (packet_index i = last_skew.last; i < packets.size(); ++i) {
+    const Point &offset = packets[i].Offset;
+    double min_y = (last_skew.confirmedAlpha-0.001) * offset.x + last_skew.confirmedBeta;
+    double max_y = (last_skew.confirmedAlpha+0.001) * offset.x + last_skew.confirmedBeta;
+    if ((offset.y > min_y) && (offset.y < max_y)) {
+      final_point = i;
+      final_sums = walked;
     }
-    else if (it->Offset.y > max_y) {
+    else if (offset.y > max_y) {
       break;
     }
+    walked.add(offset);
   }
   if (final_point != last_skew.last) {
     last_skew.last = final_point;
-    packet_iterator after_last = final_point; ++after_last;
-    ClockSkewPair final_skew = compute_skew(last_skew.first, after_last);
+    last_skew.lastSums += final_sums;
+    std::vector<Point> final_hull;
+    upper_hull(last_skew.first, final_point + 1, final_hull);
+    ClockSkewPair final_skew = compute_skew(final_hull, last_skew.lastSums + packets[final_point].Offset);
     last_skew.confirmedAlpha = final_skew.Alpha;
     last_skew.confirmedBeta = final_skew.Beta;
     last_skew.confirmed = final_point;
+    last_skew.confirmedSums = last_skew.lastSums;
     return true;
   }
   return false;
 }
 
-void ComputerInfo::reduce_packets(packet_iterator start, packet_iterator end) {
-  packet_iterator current = start;
-  current++;
+void ComputerInfo::reduce_packets(packet_index start, packet_index end) {
+  packet_index current = start + 1;
   // no packets to reduce
-  if (current == packets.end() || current == end) {
+  if (current >= packets.size() || current == end) {
     return;
   }
 
   bool reduceMe = false;
 
+  // Packets are compacted in place: kept packets are moved to [start, top],
+  // original positions of the kept packets are remembered in kept_origin
+  // so that the packet segments can be updated. The packet under test is held
+  // in candidate and next is the first packet that was not visited yet.
+  packet_index top = start;
+  std::vector<packet_index> kept_origin(1, start);
+  PacketTimeInfo candidate = packets[current];
+  packet_index candidate_origin = current;
+  packet_index next = current + 1;
+
   // there are some packets between start and end
-  while (current != packets.end() && current != end) {
-    packet_iterator prev = current;
-    prev--;
-    packet_iterator next = current;
-    next++;
-    if (next == end || next == packets.end()) {
-      // last packet can't be reduced
-      break;
-    }
+  while (next != end && next < packets.size()) {
+    const PacketTimeInfo &prev = packets[top];
+    const PacketTimeInfo &following = packets[next];
 
     // current packet doesn't affect direction of skew
-    if ((prev->Offset.y > current->Offset.y) && (current->Offset.y < next->Offset.y))
+    if ((prev.Offset.y > candidate.Offset.y) && (candidate.Offset.y < following.Offset.y))
       reduceMe = true;
 
       // 
-    else if ((prev->Offset.y <= current->Offset.y) && (current->Offset.y < next->Offset.y)) {
-      double tan_curr = (current->Offset.y - prev->Offset.y) / (current->Offset.x - prev->Offset.x);
-      double tan_next = (next->Offset.y - prev->Offset.y) / (next->Offset.x - prev->Offset.x);
+    else if ((prev.Offset.y <= candidate.Offset.y) && (candidate.Offset.y < following.Offset.y)) {
+      double tan_curr = (candidate.Offset.y - prev.Offset.y) / (candidate.Offset.x - prev.Offset.x);
+      double tan_next = (following.Offset.y - prev.Offset.y) / (following.Offset.x - prev.Offset.x);
       if (tan_curr <= tan_next) {
         reduceMe = true;
       }
     }      // check here
-    else if ((prev->Offset.y > current->Offset.y) && (current->Offset.y >= next->Offset.y)) {
-      double tan_curr = (current->Offset.y - next->Offset.y) / (current->Offset.x - next->Offset.x);
-      double tan_next = (prev->Offset.y - next->Offset.y) / (next->Offset.x - prev->Offset.x);
+    else if ((prev.Offset.y > candidate.Offset.y) && (candidate.Offset.y >= following.Offset.y)) {
+      double tan_curr = (candidate.Offset.y - following.Offset.y) / (candidate.Offset.x - following.Offset.x);
+      double tan_next = (prev.Offset.y - following.Offset.y) / (following.Offset.x - prev.Offset.x);
       if (tan_curr <= tan_next) {
         reduceMe = true;
       }
     }
 
-    if (reduceMe) {
-      current = packets.erase(current);
-      // check previous packet again
-      current--;
-      if (current == start) {
-        current++;
+    if (reduceMe && top != start) {
+      // drop the candidate and check previous packet again
+      candidate = packets[top];
+      candidate_origin = kept_origin.back();
+      kept_origin.pop_back();
+      top--;
+      continue;
+    }
+    if (!reduceMe) {
+      packets[++top] = candidate;
+      kept_origin.push_back(candidate_origin);
+    }
+    candidate = packets[next];
+    candidate_origin = next;
+    next++;
+  }
+
+  // last packet can't be reduced
+  packets[++top] = candidate;
+  kept_origin.push_back(candidate_origin);
+  remove_packets(start, kept_origin, next);
+}
+
+void ComputerInfo::keep_hull_packets(packet_index start, packet_index end) {
+  if (end > packets.size()) {
+    end = packets.size();
+  }
+  if (start + 2 >= end) {
+    return;
+  }
+
+  // Indices of packets on the upper hull, see Computations::AddToUpperHull
+  std::vector<packet_index> hull;
+  for (packet_index i = start; i < end; ++i) {
+    const Point &offset = packets[i].Offset;
+    while (hull.size() >= 2 &&
+        Computations::CounterClockwiseTest(packets[hull[hull.size() - 2]].Offset, packets[hull.back()].Offset, offset) >= 0) {
+      hull.pop_back();
+    }
+    hull.push_back(i);
+  }
+  if (hull.size() == end - start) {
+    return;
+  }
+
+  for (packet_index i = 0; i < hull.size(); ++i) {
+    packets[start + i] = packets[hull[i]];
+  }
+  remove_packets(start, hull, end);
+}
+
+void ComputerInfo::retain_hull_packets(bool release) {
+  // Offsets are not known yet
+  if (freq == 0) {
+    return;
+  }
+
+  // Packets after the last point of the current segment are kept, their
+  // offsets are walked by find_jump_point and summed into lastSums
+  for (auto it = packetSegmentList.begin(); it != packetSegmentList.end(); ++it) {
+    keep_hull_packets(it->first, it->confirmed);
+    keep_hull_packets(it->confirmed, it->last);
+    auto next = std::next(it);
+    if (next != packetSegmentList.end()) {
+      keep_hull_packets(it->last, next->first);
+    }
+  }
+  if (release) {
+    packets.shrink_to_fit();
+  }
+}
+
+size_t ComputerInfo::get_memory_usage() const {
+  size_t usage = sizeof(*this) + packets.memory_usage();
+  for (auto it = packetSegmentList.begin(); it != packetSegmentList.end(); ++it) {
+    usage += sizeof(*it) + it->hull.capacity() * sizeof(Point);
+  }
+  return usage;
+}
+
+void ComputerInfo::remove_packets(packet_index start, const std::vector<packet_index> &kept_origin, packet_index next) {
+  packet_index top = start + kept_origin.size() - 1;
+  size_t removed = next - (top + 1);
+  if (removed == 0) {
+    return;
+  }
+
+  // Move the rest of the packets
+  for (packet_index i = next; i < packets.size(); ++i) {
+    packets[++top] = packets[i];
+  }
+  packets.truncate(top + 1);
+
+  // Update positions in packet segments, a removed packet is replaced by
+  // the closest previous kept packet
+  for (auto it = packetSegmentList.begin(); it != packetSegmentList.end(); ++it) {
+    packet_index *positions[] = {&it->first, &it->confirmed, &it->last};
+    for (unsigned int i = 0; i < 3; i++) {
+      packet_index &position = *positions[i];
+      if (position >= next) {
+        position -= removed;
+      }
+      else if (position > start) {
+        position = start + (std::upper_bound(kept_origin.begin(), kept_origin.end(), position) - kept_origin.begin()) - 1;
       }
-    } else {
-      current++;
     }
   }
 }
@@ -361,14 +501,15 @@ void ComputerInfo::reduce_packets(packet_iterator start, packet_iterator end) {
 void ComputerInfo::restart(double packet_delivered, uint64_t timestamp) {
   packets.clear();
   freq = 0;
+  frequencyEstimator.clear();
   lastPacketTime = packet_delivered;
   startTime = packet_delivered;
   packetSegmentList.clear();
   insert_packet(packet_delivered, timestamp);
-  add_empty_packet_segment(packets.begin());
+  add_empty_packet_segment(0);
 }
 
-void ComputerInfo::add_empty_packet_segment(packetTimeInfoList::iterator start) {
+void ComputerInfo::add_empty_packet_segment(packet_index start) {
   PacketSegment skew;
   skew.alpha = UNDEFINED_SKEW;
   skew.beta = UNDEFINED_SKEW;
@@ -376,45 +517,48 @@ void ComputerInfo::add_empty_packet_segment(packetTimeInfoList::iterator start)
   skew.confirmedBeta = UNDEFINED_SKEW;
   skew.first = start;
   skew.confirmed = start;
-  skew.last = --packets.end();
+  skew.last = packets.size() - 1;
+  update_segment(skew);
+  // Only the last segment is extended by new packets
+  if (!packetSegmentList.empty()) {
+    std::vector<Point>().swap(packetSegmentList.back().hull);
+  }
   packetSegmentList.push_back(skew);
 #ifdef DEBUG
-  printf("%s: New empty skew first: %g, confirmed %g, last: %g\n", address.c_str(), (skew.first)->Offset.x, (skew.confirmed)->Offset.x, (skew.last)->Offset.x);
+  printf("%s: New empty skew first: %g, confirmed %g, last: %g\n", address.c_str(), packets[skew.first].Offset.x, packets[skew.confirmed].Offset.x, packets[skew.last].Offset.x);
 #endif
 }
 
-ClockSkewPair ComputerInfo::compute_skew(const packet_iterator &start, const packet_iterator &end) {
-  // Prepare an array of all points for convex hull computation
-  unsigned long pckts_count = get_packets_count();
-  Point points[pckts_count];
-  const PacketTimeInfo &first = *(start);
-  ClockSkewPair result(UNDEFINED_SKEW, UNDEFINED_SKEW);
+OffsetSums ComputerInfo::sum_offsets(packet_index start, packet_index end) const {
+  OffsetSums sums;
+  for (packet_index i = start; i < end && i < packets.size(); ++i) {
+    sums.add(packets[i].Offset);
+  }
+  return sums;
+}
+
+void ComputerInfo::upper_hull(packet_index start, packet_index end, std::vector<Point> &hull) const {
+  hull.clear();
+  for (packet_index i = start; i < end && i < packets.size(); ++i) {
+    Computations::AddToUpperHull(hull, packets[i].Offset);
+  }
+}
 
-  /// First point
-  points[0].x = first.Offset.x;
-  points[0].y = first.Offset.y;
+void ComputerInfo::update_segment(PacketSegment &segment) const {
+  segment.confirmedSums = sum_offsets(segment.first, segment.confirmed);
+  segment.lastSums = segment.confirmedSums + sum_offsets(segment.confirmed, segment.last);
+  segment.sums = segment.lastSums + sum_offsets(segment.last, packets.size());
+  upper_hull(segment.first, packets.size(), segment.hull);
+}
 
-  unsigned long i = 1;
-  auto it = start;
-  if (it == packets.end()) {
+ClockSkewPair ComputerInfo::compute_skew(const std::vector<Point> &hull, const OffsetSums &sums) {
+  ClockSkewPair result(UNDEFINED_SKEW, UNDEFINED_SKEW);
+  // Number of points in the convex hull
+  unsigned long pckts_count = hull.size();
+  if (pckts_count < 2) {
     return result;
-  } else {
-    ++it;
-    if (it == packets.end()) {
-      return result;
-    }
-  }
-  for (; (it != end) && (it != packets.end()); ++it) {
-    points[i].x = it->Offset.x;
-    points[i].y = it->Offset.y;
-    i++;
   }
-  pckts_count = i;
-
-  // Compute upper convex hull, note that points are destroyed inside the function
-  // and pckts_count will refer to the number of points in the convex hull when
-  // the function finish
-  Point *hull = Computations::ConvexHull(points, &pckts_count);
+  unsigned long i;
 
   // alpha is tangent of the line, beta is the Offset
   // y = alpha * x + beta
@@ -435,10 +579,7 @@ ClockSkewPair ComputerInfo::compute_skew(const packet_iterator &start, const pac
   }
 
   beta = hull[j - 1].y - (alpha * hull[j - 1].x);
-  min = 0.0;
-  for (auto it = start; (it != end) && (it != packets.end()); ++it) {
-    min += alpha * it->Offset.x + beta - it->Offset.y;
-  }
+  min = sums.distance(alpha, beta);
 
   // Store computed alpha, beta; it may change if other sectors of convex hull are part
   // of the line with minimal distance
@@ -450,12 +591,45 @@ ClockSkewPair ComputerInfo::compute_skew(const packet_iterator &start, const pac
   printf("[%lf,%lf],[%lf,%lf], f(x) = %lf*x + %lf, sum = %lf\n", hull[j - 1].x, hull[j - 1].y, hull[j].x, hull[j].y, alpha, beta, min);
 #endif
 
-  // Compute alpha, beta, sum for other sectors
-  for (i = 1; i < pckts_count; i++) {
+  // The sum of distances of a line touching the hull in point p changes with
+  // the slope of the line by count * (mean x - p.x), so the sum is a convex
+  // function of the sector and it is minimal for the sector around the mean x.
+  // Sectors are ordered by a decreasing slope, too steep sectors are
+  // at the beginning and at the end of the hull.
+  auto sector_alpha = [&hull](unsigned long i) {
+    return (hull[i].y - hull[i - 1].y) / (hull[i].x - hull[i - 1].x);
+  };
+  unsigned long lo = 1, hi = pckts_count;
+  while (lo < hi) {
+    unsigned long mid = (lo + hi) / 2;
+    if (sector_alpha(mid) > 3)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  unsigned long first_sector = lo;
+  hi = pckts_count;
+  while (lo < hi) {
+    unsigned long mid = (lo + hi) / 2;
+    if (sector_alpha(mid) < -3)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  unsigned long end_sector = lo;
+
+  double mean_x = sums.x / sums.count;
+  unsigned long center = std::lower_bound(hull.begin() + 1, hull.end() - 1, mean_x,
+      [](const Point &p, double x) { return p.x < x; }) - hull.begin();
+  center = std::max(first_sector, std::min(center, end_sector - 1));
+
+  // Compute alpha, beta, sum for the sectors around the minimum, a neighbour
+  // on each side is checked against rounding errors
+  for (i = (center > first_sector) ? center - 1 : first_sector; i <= center + 1 && i < end_sector; i++) {
     if (i == j) // We already computed j-th sector
       continue;
 
-    alpha = ((hull[i].y - hull[i - 1].y) / (hull[i].x - hull[i - 1].x));
+    alpha = sector_alpha(i);
 
     /// Too steep
     if (alpha > 3 || alpha < -3)
@@ -464,12 +638,7 @@ ClockSkewPair ComputerInfo::compute_skew(const packet_iterator &start, const pac
     beta = hull[i - 1].y - (alpha * hull[i - 1].x);
 
     /// SUM
-    sum = 0.0;
-    for (auto it = start; (it != end) && (it != packets.end()); ++it) {
-      sum += (alpha * it->Offset.x + beta - it->Offset.y);
-      if (sum >= min) // The sum is already higher than the sum of all points of other sectors
-        break;
-    }
+    sum = sums.distance(alpha, beta);
 
 #ifdef DEBUG
     printf("[%lf,%lf],[%lf,%lf], f(x) = %lf*x + %lf, sum = %lf\n", hull[i - 1].x, hull[i - 1].y, hull[i].x, hull[i].y, alpha, beta, sum);
@@ -490,38 +659,20 @@ ClockSkewPair ComputerInfo::compute_skew(const packet_iterator &start, const pac
   return result;
 }
 
-int ComputerInfo::compute_freq() {
-  assert(!packets.empty());
-
-  const PacketTimeInfo &first = *packets.begin();
-
-  double tmp = 0.0;
-  int count = 0;
-
-  for (auto it = ++packets.begin(); it != packets.end(); ++it) {
-    double local_diff = it->ArrivalTime - first.ArrivalTime;
-    if (local_diff > 60.0) {
-      tmp += ((it->Timestamp - first.Timestamp) / local_diff);
-      count++;
-    }
+int ComputerInfo::compute_freq(double packet_delivered) {
+  int freq;
+  if ((packet_delivered - startTime) < FREQ_ESTIMATE_AFTER) {
+    // Snap early only to a common frequency
+    freq = frequencyEstimator.confident_frequency();
   }
-
-  if (count < 10) {
+  else {
+    freq = frequencyEstimator.mean_frequency();
+  }
+  if (freq == 0) {
     // Wait for more packets
     return 0;
   }
 
-  /// According to the real world, but sometimes can be wrong, it depends...
-  int freq = (int) round(tmp / count);
-  if (freq >= 970 && freq <= 1030)
-    freq = 1000;
-  else if (freq >= 95 && freq <= 105)
-    freq = 100;
-  else if (freq >= 230 && freq <= 270)
-    freq = 250;
-  else if (freq >= 9990000 && freq <= 10010000)
-    freq = 10000000;
-
   if (Configurator::instance()->verbose) {
     printf("Frequency of %s (Hz): %d\n", address.c_str(), freq);
   }
@@ -532,21 +683,30 @@ int ComputerInfo::compute_freq() {
 int ComputerInfo::save_packets() const {
   std::stringstream filename_s;
   filename_s << "log/" << static_cast<ComputerInfoList *> (parentList)->getOutputDirectory() <<
-    get_address() << ".log";
-
-  std::ofstream f(filename_s.str());
-  f << std::setprecision(6) << std::fixed;
-
-  if (!f.good()) {
-    std::cerr << "Cannot save packets into the file: " << filename_s.str() << std::endl;
-    return (2);
+    get_address() << ".plog";
+
+  // Only records since the last save are appended, the first save of the
+  // computer replaces a log of an older computer with the same address
+  if (!logCreated) {
+    std::string data;
+    PacketLog::AddHeader(data);
+    data += pendingLog;
+    OutputQueue::instance()->Replace(filename_s.str(), data);
+    logCreated = true;
   }
-
-  /// Write to file
-  for (auto it = packets.begin(); it != packets.end(); ++it) {
-    f << it->Offset.x << "\t" << it->Offset.y << "\t" << it->ArrivalTime <<
-      "\t" << it->Timestamp << std::endl;
+  else {
+    OutputQueue::instance()->Append(filename_s.str(), pendingLog);
   }
+  pendingLog.clear();
 
   return (0);
 }
+
+void ComputerInfo::flush_skew_log() {
+  if (!skewLog.empty()) {
+    std::string type = static_cast<ComputerInfoList *> (parentList)->getOutputDirectory();
+    type.resize(type.size() - 1);
+    OutputQueue::instance()->Append("log/" + address + "-" + type + ".dat", skewLog);
+    skewLog.clear();
+  }
+}
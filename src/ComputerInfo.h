@@ -21,16 +21,50 @@
 #ifndef _COMPUTER_INFO_H
 #define _COMPUTER_INFO_H
 
+#include <ctime>
 #include <list>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "AddressKey.h"
 #include "TimeSegment.h"
 #include "PacketTimeInfo.h"
+#include "PacketStore.h"
 #include "TimeSegmentList.h"
 #include "ClockSkewPair.h"
+#include "FrequencyEstimator.h"
 #include "PacketSegment.h"
 
+/**
+ * Element of a computer in active.xml and the state it was serialized from,
+ * the element is serialized again only when the state changes
+ */
+struct ActiveFragment {
+  std::string xml;
+  int freq;
+  unsigned long packets;
+  time_t date;
+  unsigned long skewVersion;
+  /// Version of the similarity graph (SimilarityGraph::Version) of the computer
+  unsigned long similarityVersion;
+  /// Version of the saved computers (SavedComputers::get_version)
+  unsigned long savedVersion;
+  identity_container identities;
+  int cluster;
+};
+
+/**
+ * Counters of a computer for readers from other shards. The owner of the
+ * computer changes its packets without the group lock, so other shards read
+ * this copy, which the owner refreshes under the group lock.
+ */
+struct ComputerSummary {
+  int freq;
+  unsigned long packets;
+  double lastPacketTime;
+};
+
 /**
  * All informations known about each computer including time information about all received packets.
  */
@@ -38,12 +72,21 @@ class ComputerInfo {
 
   // Private types
   private:
-    /// List of time informations about packets
-    packetTimeInfoList packets;
+    /// Time informations about packets
+    PacketStore packets;
+
+    /// Log records of packets that were not saved yet
+    mutable std::string pendingLog;
+
+    /// True if the log file of this computer was already created
+    mutable bool logCreated;
 
     /// Frequency of the computer
     int freq;
 
+    /// Running estimate of the frequency while it is not known
+    FrequencyEstimator frequencyEstimator;
+
     /// Time of the last added packet
     double lastPacketTime;
 
@@ -62,14 +105,11 @@ class ComputerInfo {
     // pointer to the parent list of computers that includes this one
     void * parentList;
 
-    /// Complete address of the computer
-    std::string address;
-    
-    /// IP address of the computer
-    const std::string ipAddress;
+    /// Binary address (and port) of the computer
+    const AddressKey key;
 
-    ///
-    const uint16_t port;
+    /// Complete address of the computer, text form of the key used in outputs
+    std::string address;
     
     double variance;
     double avg;
@@ -86,16 +126,37 @@ class ComputerInfo {
     double preliminarySum2;
     double preliminaryAverage;
 
+    /// Clock skews after every packet (-f) that were not written yet
+    std::string skewLog;
+
     // Public attributes
   public:
     /// FIXME - comment needed
     bool firstPacketReceived;
 
+    /// Position in the list of computers of the parent list
+    std::list<ComputerInfo *>::iterator listPosition;
+
+    /// Position in the list of the parent ordered by the last packet time
+    std::list<ComputerInfo *>::iterator idlePosition;
+
+    /// Incremented whenever timeSegmentList is replaced
+    unsigned long skewVersion;
+
+    /// Counters published for other shards, see publish_summary()
+    ComputerSummary summary;
+
+    /// Cached element of active.xml
+    ActiveFragment activeFragment;
+
+    /// Slot of the computer in the shared live state, -1 if it has none
+    int stateSlot;
+
   // Constructors
   public:
-    ComputerInfo(void * parentList, const char* its_address, u_int16_t port);
+    ComputerInfo(void * parentList, const AddressKey &its_key);
 
-    ~ComputerInfo();
+    virtual ~ComputerInfo();
 
   // Public methods
   public:
@@ -104,14 +165,9 @@ class ComputerInfo {
       return address;
     }
     
-    const std::string& get_ipAddress() const
+    const AddressKey& get_key() const
     {
-      return ipAddress;
-    }
-    
-    uint16_t get_port() const
-    {
-      return port;
+      return key;
     }
 
     int get_freq() const
@@ -129,6 +185,20 @@ class ComputerInfo {
       return lastPacketTime;
     }
 
+    /// Sets the last activity of a computer that has not sent any packet yet (a poked computer)
+    void set_last_packet_time(double time)
+    {
+      lastPacketTime = time;
+    }
+
+    /// Copies the counters into summary, only the owner calls it under the group lock
+    void publish_summary()
+    {
+      summary.freq = freq;
+      summary.packets = packets.size();
+      summary.lastPacketTime = lastPacketTime;
+    }
+
     double get_start_time() const
     {
       return startTime;
@@ -136,7 +206,7 @@ class ComputerInfo {
 
     uint64_t get_last_packet_timestamp() const
     {
-      return packets.rbegin()->Timestamp;
+      return packets.back().Timestamp;
     }
 
     // TODO: why not confirmedSkew.Alpha or last TimeSegment from TimeSegmentList ?
@@ -173,23 +243,67 @@ class ComputerInfo {
     void restart(double packet_delivered, uint64_t timestamp);
     
     /// Reduces unnecessary information about packets
-    void reduce_packets(packet_iterator start, packet_iterator end);
+    void reduce_packets(packet_index start, packet_index end);
+
+    /**
+     * Drops packets that cannot change the clock skew. A packet that is not
+     * on the upper convex hull of a range of packets cannot be on the hull of
+     * any superset of the range, so the ranges [first, confirmed) and
+     * [confirmed, last) of each segment and the tails of closed segments are
+     * reduced to their hull points. Running sums of the segments are kept.
+     * Packets after the last point of the current segment are never reduced,
+     * find_jump_point sums them when the segment is closed.
+     * @param[in] release Return the freed memory of the packet store
+     */
+    void retain_hull_packets(bool release);
+
+    /// Returns the estimated number of bytes used by the packets and segments
+    size_t get_memory_usage() const;
 
     /** 
-     * Save packets into file (called 'IP address.log')
+     * Appends packets received since the last call to the binary log
+     * (called 'IP address.plog', see PacketLog)
      * @return 0            if ok
      * */
     int save_packets() const;
 
+    /// Writes buffered clock skews computed after every packet (-f) to the file
+    void flush_skew_log();
+
   private:
     /// Performs actions after a block of packets is captured
     void recompute_block(double packet_delivered);
+    /// Keeps only packets [start, end) on the upper convex hull of their offsets
+    void keep_hull_packets(packet_index start, packet_index end);
+    /**
+     * Removes packets [start, next) that were not kept and updates packet
+     * segments, kept packets have already been moved to the beginning of the range
+     * @param[in] start First packet of the range
+     * @param[in] kept_origin Original indices of the kept packets
+     * @param[in] next First packet after the range
+     */
+    void remove_packets(packet_index start, const std::vector<packet_index> &kept_origin, packet_index next);
     /// Adds initialized empty skew information
-    void add_empty_packet_segment(packetTimeInfoList::iterator start);
-    /// Computes a new skew
-    ClockSkewPair compute_skew(const packet_iterator &start, const packet_iterator &end);
-    /// Computes a new frequency
-    int compute_freq();
+    void add_empty_packet_segment(packet_index start);
+    /**
+     * Computes a new skew of a range of packets
+     * @param[in] hull Upper convex hull of offsets of the packets
+     * @param[in] sums Sums of offsets of the packets
+     */
+    ClockSkewPair compute_skew(const std::vector<Point> &hull, const OffsetSums &sums);
+    /// Sums offsets of packets [start, end)
+    OffsetSums sum_offsets(packet_index start, packet_index end) const;
+    /// Computes upper convex hull of offsets of packets [start, end)
+    void upper_hull(packet_index start, packet_index end, std::vector<Point> &hull) const;
+    /// Recomputes sums and hull of the packet segment after its offsets changed
+    void update_segment(PacketSegment &segment) const;
+    /**
+     * Decides the frequency from its running estimate, a common frequency is
+     * accepted before FREQ_ESTIMATE_AFTER if the estimate is confident
+     * @param[in] packet_delivered Arrival time of the last packet
+     * @return Frequency or 0 if more packets are needed
+     */
+    int compute_freq(double packet_delivered);
 
 		/// Outputs summary results of clock skew computed per packet
 		void output_skewbypacket_results(double skew);
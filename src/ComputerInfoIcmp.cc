@@ -29,6 +29,7 @@
 #include <netinet/ip.h>
 #include <netinet/ip_icmp.h>
 #include <string.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
@@ -59,9 +60,15 @@ unsigned short in_cksum(unsigned short *addr, int len) {
   return (answer);
 }
 
+static void closeIcmpSocket(void * arg){
+  close(*static_cast<int *>(arg));
+}
+
 void * sendIcmpRequests(void * arg){
   ComputerInfo * computer = static_cast<ComputerInfo*>(arg);
   int s;
+  // The computer may be deleted only while the requests are being sent
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
   char buffer[1024];
   memset(buffer, 0, sizeof(buffer));
   
@@ -86,9 +93,10 @@ void * sendIcmpRequests(void * arg){
   // convert IP
   dst.sin_family = AF_INET;
   dst.sin_port = 0;
-  if (inet_pton(AF_INET, computer->get_address().c_str(), &(dst.sin_addr)) != 1) {
-    perror("could not convert IP");
+  if (!computer->get_key().IsIPv4()) {
+    fprintf(stderr, "could not convert IP\n");
   }
+  memcpy(&(dst.sin_addr), computer->get_key().addr + 12, sizeof(dst.sin_addr));
   // create IP header
   ip->ihl = 5;
   ip->version = 4;
@@ -107,6 +115,9 @@ void * sendIcmpRequests(void * arg){
   
   if(Configurator::instance()->verbose)
     std::cout << "ICMP timestamp requests started to IP: " << computer->get_address() << std::endl;
+  // The thread is cancelled in sendto() or sleep() when the computer expires
+  pthread_cleanup_push(closeIcmpSocket, &s);
+  pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
   while (1) {
     icmp->checksum = 0;
     icmp->checksum = in_cksum((unsigned short *) icmp, sizeof (struct icmphdr));
@@ -116,8 +127,17 @@ void * sendIcmpRequests(void * arg){
     
     sleep(1);
   }
+  pthread_cleanup_pop(1);
+  return NULL;
+}
+
+ComputerInfoIcmp::~ComputerInfoIcmp(){
+  if (poking) {
+    pthread_cancel(pokingThread);
+    pthread_join(pokingThread, NULL);
+  }
 }
 
 void ComputerInfoIcmp::StartPoking(){
-  pthread_create(&pokingThread, NULL, sendIcmpRequests , this);
+  poking = (pthread_create(&pokingThread, NULL, sendIcmpRequests , this) == 0);
 }
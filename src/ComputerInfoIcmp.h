@@ -28,8 +28,11 @@
 class ComputerInfoIcmp : public ComputerInfo {
 private:
     pthread_t pokingThread;
+    bool poking;
 public:
-    explicit ComputerInfoIcmp(ComputerInfoList * parent, const char * address, uint16_t port) : ComputerInfo(parent, address, port){};
+    explicit ComputerInfoIcmp(ComputerInfoList * parent, const AddressKey &key) : ComputerInfo(parent, key), poking(false){};
+    /// Stops poking of an expired computer
+    virtual ~ComputerInfoIcmp();
     void StartPoking();    
 };
 
@@ -19,6 +19,7 @@
  * along with pcf. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdlib.h>
@@ -28,158 +29,328 @@
 #include "check_computers.h"
 #include "Configurator.h"
 #include "ComputerInfoIcmp.h"
+#include "LiveState.h"
+
+ShardGroup::ShardGroup(): shards(), skews(), similarity(), saved(), lastXMLupdate(0) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
 
-ComputerInfoList::~ComputerInfoList() {
+ShardGroup::~ShardGroup() {
+  pthread_mutex_destroy(&lock);
+}
+
+ComputerInfoList::ComputerInfoList(std::string type, ShardGroup *group, bool concurrent):
+  computers(), index(), idle(), type(type), group(group), ownGroup(false), concurrent(concurrent) {
+  if (this->group == NULL) {
+    this->group = new ShardGroup();
+    ownGroup = true;
+  }
+  ShardLock lock(this->group);
+  this->group->shards.push_back(this);
+  this->group->saved.set_filenames(Configurator::xmlDir + getOutputDirectory() + Configurator::instance()->database,
+      Configurator::xmlDir + getOutputDirectory() + Configurator::instance()->store);
 }
 
-void ComputerInfoList::to_poke_or_not_to_poke(std::string address) {
-  // try to find computer, return if already present and poking
-  for (std::list<ComputerInfo *>::iterator it = computers.begin(); it != computers.end(); ++it) {
-    if ((*it)->get_ipAddress() == address)
-      return;
+ComputerInfoList::~ComputerInfoList() {
+  if (ownGroup) {
+    delete group;
   }
+}
+
+void ComputerInfoList::to_poke_or_not_to_poke(const AddressKey &key, double ttime) {
+  ShardLock lock(group);
+  // return if the computer is already present and poking
+  if (index.Find(key) != NULL)
+    return;
   // computer was not found, add new to the list
-  ComputerInfoIcmp *new_computer = new ComputerInfoIcmp(this, address.c_str(), 0);
+  ComputerInfoIcmp *new_computer = new ComputerInfoIcmp(this, key);
 
   // decouple new thread to poke the computer under given address
   new_computer->StartPoking();
-  computers.push_back(new_computer);
+  new_computer->set_last_packet_time(ttime);
+  new_computer->publish_summary();
+  new_computer->listPosition = computers.insert(computers.end(), new_computer);
+  // A computer that never replies expires as any other inactive computer
+  new_computer->idlePosition = idle.insert(idle.end(), new_computer);
+  index.Insert(key, new_computer);
   save_active_computers();
 }
 
-bool ComputerInfoList::new_packet(const char *address, u_int16_t port, double ttime, uint64_t timestamp) {
-  bool found = false;
+void ComputerInfoList::known_packet(ComputerInfo &known_computer, double ttime, uint64_t timestamp) {
+  // first received packet for this IP (ICMP)
+  if (!known_computer.firstPacketReceived) {
+    known_computer.insert_first_packet(ttime, timestamp);
+    return;
+  }
 
-  for (std::list<ComputerInfo *>::iterator it = computers.begin(); it != computers.end(); ++it) {
-    if ((*it)->get_ipAddress() != address) {
-      continue;
-    }
-    
-    if(Configurator::instance()->portEnable && (*it)->get_port() != port){
-      continue;
-    }
-    found = true;
+  /// Too much time since last packet so start from the beginning
+  if ((ttime - known_computer.get_last_packet_time()) > Configurator::instance()->timeLimit) {
+    ShardLock lock(group);
+    known_computer.restart(ttime, timestamp);
+    known_computer.publish_summary();
+    if (Configurator::instance()->verbose)
+      fprintf(stderr, "%s timeout: starting a new tracking\n", known_computer.get_address().c_str());
+    save_active_computers();
+    return;
+  }
 
-    // Computer already known
-    ComputerInfo &known_computer = **it;
+  // Check if packet has the same or lower timestamp
+  if (timestamp <= known_computer.get_last_packet_timestamp() && Configurator::instance()->setFreq == 0) {
+    if (Configurator::instance()->verbose)
+      if (timestamp < known_computer.get_last_packet_timestamp())
+        fprintf(stderr, "%s: Lower timestamp %lu %lu\n", known_computer.get_address().c_str(), timestamp, known_computer.get_last_packet_timestamp());
+    return;
+  }
 
-    // first received packet for this IP (ICMP)
-    if (!known_computer.firstPacketReceived) {
-      known_computer.insert_first_packet(ttime, timestamp);
-      break;
-    }
+  // Stop tracking addresses with too high frequency
+  if (std::fabs(known_computer.get_freq()) > 100000000) {
+    if (Configurator::instance()->verbose)
+      fprintf(stderr, "%s: too high frequency of %d\n", known_computer.get_address().c_str(), known_computer.get_freq());
+    ShardLock lock(group);
+    known_computer.restart(ttime, timestamp);
+    known_computer.publish_summary();
+    return;
+  }
+  // Insert packet
+  known_computer.insert_packet(ttime, timestamp);
+  if (known_computer.check_block_finish(ttime)) {
+    ShardLock lock(group);
+    update_skew(known_computer.get_address(), known_computer.NewTimeSegmentList);
+    save_active_computers();
+  }
 
-    /// Too much time since last packet so start from the beginning
-    if ((ttime - known_computer.get_last_packet_time()) > Configurator::instance()->timeLimit) {
-      known_computer.restart(ttime, timestamp);
-      if (Configurator::instance()->verbose)
-        fprintf(stderr, "%s timeout: starting a new tracking\n", known_computer.get_address().c_str());
-      save_active_computers();
-      break;
-    }
+#if 0
+  std::cerr << known_computer.get_address() << ": " << known_computer.get_packet_count() << std::endl;
+#endif
+}
 
-    // Check if packet has the same or lower timestamp
-    if (timestamp <= known_computer.get_last_packet_timestamp() && Configurator::instance()->setFreq == 0) {
-      if (Configurator::instance()->verbose)
-        if (timestamp < known_computer.get_last_packet_timestamp())
-          fprintf(stderr, "%s: Lower timestamp %lu %lu\n", known_computer.get_address().c_str(), timestamp, known_computer.get_last_packet_timestamp());
-      break;
-    }
+bool ComputerInfoList::new_packet(const AddressKey &key, double ttime, uint64_t timestamp) {
+  // Computers of this list may be added by other workers
+  if (concurrent) {
+    group->Lock();
+  }
 
-    // Stop tracking addresses with too high frequency
-    if (std::fabs(known_computer.get_freq()) > 100000000) {
-      if (Configurator::instance()->verbose)
-        fprintf(stderr, "%s: too high frequency of %d\n", known_computer.get_address().c_str(), known_computer.get_freq());
-      known_computer.restart(ttime, timestamp);
-      break;
+  ComputerInfo *known_computer = index.Find(key);
+  bool found = (known_computer != NULL);
+  if (found) {
+    double last_packet_time = known_computer->get_last_packet_time();
+    known_packet(*known_computer, ttime, timestamp);
+    enforce_memory_limit(*known_computer);
+    LiveState::instance()->PublishCounters(*known_computer);
+    // Rejected packets do not change the activity of the computer
+    if (known_computer->idlePosition == idle.end() || known_computer->get_last_packet_time() != last_packet_time) {
+      touch(*known_computer);
     }
-    // Insert packet
-    known_computer.insert_packet(ttime, timestamp);
-    if (known_computer.check_block_finish(ttime)) {
-      update_skew(known_computer.get_address(), known_computer.NewTimeSegmentList);
-      save_active_computers();
-    }
-    //std::cout << (*it)->get_ipAddress() << " packets in line: " << known_computer.get_packets_count() << std::endl;
-
-#if 0
-    std::cerr << known_computer.get_address() << ": " << known_computer.get_packet_count() << std::endl;
-#endif
   }
 
   if (!found) {
-    ComputerInfo *new_computer = new ComputerInfo(this, address, port);
+    ShardLock lock(group);
+    ComputerInfo *new_computer = new ComputerInfo(this, key);
     new_computer->firstPacketReceived = false;
     new_computer->insert_first_packet(ttime, timestamp);
-    computers.push_back(new_computer);
+    new_computer->publish_summary();
+    new_computer->listPosition = computers.insert(computers.end(), new_computer);
+    new_computer->idlePosition = idle.insert(idle.end(), new_computer);
+    index.Insert(key, new_computer);
     //std::cout << "**saving active not found**" << std::endl;
     save_active_computers();
   }
   
   // timeLimit = 3600 s (default)
-  // removed "if (ttime > (last_inactive + Configurator::instance()->timeLimit / 4))"
-  // xml refresh every 9 minutes
-  if (ttime > (last_inactive + 30)) {
-    /// Save active computers & erase inactive
-    for (std::list<ComputerInfo *>::iterator it = computers.begin(); it != computers.end(); ++it) {
-      if (ttime - (*it)->get_last_packet_time() > Configurator::instance()->timeLimit) {
-        construct_notify((*it)->get_ipAddress());
-        delete(*it);
-        it = computers.erase(it);
-      }
-    }
-    //std::cout << "**saving active found**" << std::endl;
-    save_active_computers();
-    last_inactive = ttime;
+  expire_inactive(ttime);
+
+  if (concurrent) {
+    group->Unlock();
   }
   return found;
 }
 
+void ComputerInfoList::enforce_memory_limit(ComputerInfo &computer) {
+  size_t limit = Configurator::instance()->hostMemoryLimit;
+  if (limit == 0 || computer.get_memory_usage() <= limit) {
+    return;
+  }
+
+  // Pruning walks all retained packets, it has to free a quarter of the
+  // limit so that the next pruning comes only after many new packets
+  computer.retain_hull_packets(true);
+  if (computer.get_memory_usage() <= limit / 4 * 3) {
+    return;
+  }
+
+  ShardLock lock(group);
+  if (Configurator::instance()->verbose)
+    fprintf(stderr, "%s: memory limit exceeded, starting a new tracking\n", computer.get_address().c_str());
+  computer.restart(computer.get_last_packet_time(), computer.get_last_packet_timestamp());
+  computer.publish_summary();
+  save_active_computers();
+}
+
+void ComputerInfoList::touch(ComputerInfo &computer) {
+  if (computer.idlePosition == idle.end()) {
+    computer.idlePosition = idle.insert(idle.end(), &computer);
+  }
+  else {
+    idle.splice(idle.end(), idle, computer.idlePosition);
+  }
+}
+
+void ComputerInfoList::expire_inactive(double ttime) {
+  if (idle.empty() || ttime - idle.front()->get_last_packet_time() <= Configurator::instance()->timeLimit) {
+    return;
+  }
+
+  ShardLock lock(group);
+  /// Erase inactive & save active computers
+  while (!idle.empty() && ttime - idle.front()->get_last_packet_time() > Configurator::instance()->timeLimit) {
+    ComputerInfo *inactive = idle.front();
+    construct_notify(inactive->get_address());
+    index.Erase(inactive->get_key());
+    group->skews.Erase(inactive);
+    if (LiveState::instance()->Enabled()) {
+      // The cluster of the inactive computer may split
+      std::vector<ComputerInfo *> changed;
+      group->similarity.ClusterMembers(inactive, changed);
+      group->similarity.Erase(inactive);
+      changed.erase(std::find(changed.begin(), changed.end(), inactive));
+      LiveState::instance()->Remove(*inactive);
+      publish_state(NULL, changed);
+    }
+    else {
+      group->similarity.Erase(inactive);
+    }
+    computers.erase(inactive->listPosition);
+    idle.pop_front();
+    delete inactive;
+  }
+  save_active_computers();
+}
+
 void ComputerInfoList::construct_notify(const std::string &ip, const identity_container &identitites, const TimeSegmentList &s) const {
   AnalysisInfo cs = {ip, identitites, s};
   Notify("active", cs);
 }
 
+void ComputerInfoList::construct_notify(ComputerInfo *computer) {
+  construct_notify(computer->get_address(), get_similar_identities(computer->get_address()), computer->timeSegmentList);
+}
+
 void ComputerInfoList::construct_notify(const std::string &ip) const {
   AnalysisInfo cs = {ip};
   Notify("inactive", cs);
 }
 
-TimeSegmentList * ComputerInfoList::getSkew(std::string ip) {
-  for (std::list<ComputerInfo *>::iterator it = computers.begin(); it != computers.end(); ++it) {
-    if ((*it)->get_address() == ip) {
-      return &((*it)->timeSegmentList);
+ComputerInfo * ComputerInfoList::find_computer(const std::string &ip) const {
+  AddressKey key;
+  if (!AddressKey::Parse(ip, key)) {
+    return NULL;
+  }
+  if (!Configurator::instance()->portEnable) {
+    key.port = 0;
+  }
+  for (auto shard = group->shards.begin(); shard != group->shards.end(); ++shard) {
+    ComputerInfo *computer = (*shard)->index.Find(key);
+    if (computer != NULL) {
+      return computer;
     }
   }
   return NULL;
 }
 
+static bool address_less(const ComputerInfo *a, const ComputerInfo *b)
+{
+  return a->get_address() < b->get_address();
+}
+
 void ComputerInfoList::update_skew(const std::string &ip, const TimeSegmentList &s) {
-  identity_container old_identities = get_similar_identities(ip);
+  ShardLock lock(group);
 
   // Update database, be it a new address or an update
-  TimeSegmentList * target_skew = getSkew(ip);
+  ComputerInfo * target = find_computer(ip);
   //
-  if (target_skew == NULL) {
+  if (target == NULL) {
     std::cerr << "Pseudo-exception: entry should be present in computer list, but is not. Ip=" << ip << std::endl;
     exit(1);
   }
+  identity_container old_saved;
+  find_saved(target->timeSegmentList, old_saved);
   //
-  *(getSkew(ip)) = s;
+  target->timeSegmentList = s;
+  target->skewVersion++;
+  target->publish_summary();
+  group->skews.Update(target, s);
+
+  // Only edges of the updated computer are evaluated again
+  std::vector<ComputerInfo *> candidates;
+  std::vector<ComputerInfo *> similar;
+  group->skews.FindCandidates(s, Configurator::instance()->threshold, candidates);
+  for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+    if (*it != target && s.is_similar_with((*it)->timeSegmentList, Configurator::instance()->threshold)) {
+      similar.push_back(*it);
+    }
+  }
+  std::vector<ComputerInfo *> removed;
+  std::vector<ComputerInfo *> added;
+  group->similarity.SetNeighbors(target, similar, removed, added);
+
+  // Notify observers (skew_change_exporter only), computers whose similar
+  // identities changed follow the updated computer with their own skew
+  construct_notify(target);
+  std::sort(removed.begin(), removed.end(), address_less);
+  for (auto it = removed.begin(); it != removed.end(); ++it) {
+    construct_notify(*it);
+  }
+  std::sort(added.begin(), added.end(), address_less);
+  for (auto it = added.begin(); it != added.end(); ++it) {
+    construct_notify(*it);
+  }
 
-  // Notify observers (skew_change_exporter only)
-  identity_container new_identities = get_similar_identities(ip);
-  construct_notify(ip, new_identities, s);
-  
+  // Saved computers that started or stopped matching the updated computer
+  // are notified by their name with the skew of the updated computer
+  identity_container new_saved;
+  find_saved(s, new_saved);
+  for (auto it = old_saved.begin(); it != old_saved.end(); ++it) {
+    if (new_saved.find(*it) == new_saved.end()) {
+      construct_notify(*it, identity_container(), s);
+    }
+  }
+  for (auto it = new_saved.begin(); it != new_saved.end(); ++it) {
+    if (old_saved.find(*it) == old_saved.end()) {
+      construct_notify(*it, identity_container(), s);
+    }
+  }
 
-  for (identity_container::iterator it = old_identities.begin(); it != old_identities.end(); ++it) {
-    if (new_identities.find(*it) == new_identities.end()) {
-      construct_notify(*it, get_similar_identities(*it), *(getSkew(ip)));
+  if (LiveState::instance()->Enabled()) {
+    // Clusters of all computers whose cluster may have changed are published,
+    // added computers are in the cluster of the target now
+    std::vector<ComputerInfo *> changed;
+    if (removed.empty() && added.empty()) {
+      changed.push_back(target);
     }
+    else {
+      group->similarity.ClusterMembers(target, changed);
+      for (auto it = removed.begin(); it != removed.end(); ++it) {
+        if (std::find(changed.begin(), changed.end(), *it) == changed.end()) {
+          group->similarity.ClusterMembers(*it, changed);
+        }
+      }
+    }
+    publish_state(target, changed);
   }
+}
 
-  for (identity_container::iterator it = new_identities.begin(); it != new_identities.end(); ++it) {
-    if (old_identities.find(*it) == old_identities.end()) {
-      construct_notify(*it, get_similar_identities(*it), *(getSkew(ip)));
+void ComputerInfoList::publish_state(ComputerInfo *owned, const std::vector<ComputerInfo *> &changed) {
+  // Counters of computers of other shards are written by their owners only
+  if (owned != NULL) {
+    LiveState::instance()->Publish(*owned, type, group->similarity.Cluster(owned));
+  }
+  for (auto it = changed.begin(); it != changed.end(); ++it) {
+    if (*it != owned) {
+      LiveState::instance()->PublishCluster(**it, group->similarity.Cluster(*it));
     }
   }
 }
@@ -192,41 +363,45 @@ void ComputerInfoList::update_all_skews() {
 }
 
 const identity_container ComputerInfoList::get_similar_identities(const std::string &ip) {
+  ShardLock lock(group);
   identity_container identities;
 
-  TimeSegmentList * reference_skew = getSkew(ip);
-  if (reference_skew == NULL) {
+  ComputerInfo * reference = find_computer(ip);
+  if (reference == NULL) {
     // Given address is not known
     return identities;
   }
 
-  // find IP in xml database
-  /*if (reference_skew->is_constant()) {
-    find_computer_in_saved(reference_skew->get_last_alpha(), identities, Configurator::instance()->threshold, Configurator::instance()->database);
-  }*/
-
-  for (std::list<ComputerInfo *>::iterator it = computers.begin(); it != computers.end(); ++it) {
-    if ((*it)->get_address() == ip) {
-      continue;
-    }
+  // find the skew in the database of saved computers
+  find_saved(reference->timeSegmentList, identities);
 
-    if (reference_skew->is_similar_with((*it)->timeSegmentList, Configurator::instance()->threshold)) {
-      identities.insert((*it)->get_address());
-    }
+  // Addresses are resolved only now, the graph keeps computers
+  std::vector<ComputerInfo *> similar;
+  group->similarity.Neighbors(reference, similar);
+  for (auto it = similar.begin(); it != similar.end(); ++it) {
+    identities.insert((*it)->get_address());
   }
 
   return identities;
 }
 
+void ComputerInfoList::find_saved(const TimeSegmentList &skew, identity_container &names) {
+  if (!skew.empty() && skew.is_constant()) {
+    group->saved.Find(skew.get_last_alpha(), Configurator::instance()->threshold, names);
+  }
+}
+
 void ComputerInfoList::save_active_computers()
 {
-  save_active(computers, Configurator::instance()->active, *this);
+  ShardLock lock(group);
+  save_active(*group, Configurator::instance()->active, *this);
 }
 
 void ComputerInfoList::save_log()
 {
   for (auto it = computers.begin(); it != computers.end(); ++it) {
     (*it)->save_packets();
+    (*it)->flush_skew_log();
   }
 }
 
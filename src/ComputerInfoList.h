@@ -21,26 +21,44 @@
 #ifndef _COMPUTER_INFO_LIST_H
 #define _COMPUTER_INFO_LIST_H
 
+#include <ctime>
+#include <vector>
+#include <pthread.h>
+
 #include "AnalysisInfo.h"
 #include "Observer.h"
 #include "Observable.h"
 #include "ComputerInfo.h"
+#include "HostIndex.h"
+#include "SavedComputers.h"
+#include "SimilarityGraph.h"
+#include "SkewIndex.h"
+
+class ComputerInfoList;
 
 /**
- * All informations known about a set of computers.
+ * Lists of computers of the same type that are filled by different capture
+ * workers (shards). Each worker owns its shard and processes packets of known
+ * computers without locking. Operations that look at other shards (similar
+ * identities, active.xml) and changes of the set of computers or their skew
+ * are serialized by the group lock. Packets of a computer are read only by
+ * its owner, other shards read its summary (ComputerInfo::publish_summary).
  */
-class ComputerInfoList : public Observable<const AnalysisInfo> {
+class ShardGroup {
   // Attributes
   private:
-    /// Informations about packet timing
-    std::list<ComputerInfo *> computers;
-    /// Informations about clock skew
-    // clock_skew_guard skews;
-    /// Last time when inactive computers were detected
-    double last_inactive;
-    std::string type;
+    pthread_mutex_t lock;
 
   public:
+    /// Shards of the group
+    std::vector<ComputerInfoList *> shards;
+    /// Published skews of computers in all shards
+    SkewIndex skews;
+    /// Computers with similar skews in all shards
+    SimilarityGraph similarity;
+    /// Computers saved in the database by the user
+    SavedComputers saved;
+
     /**
      * Public attribute. Information here is stored outside this class.
      *
@@ -48,17 +66,133 @@ class ComputerInfoList : public Observable<const AnalysisInfo> {
      */
     time_t lastXMLupdate;
 
+  // Constructors, destructors
+  public:
+    ShardGroup();
+    ~ShardGroup();
+
+  // Public methods
+  public:
+    /// Locks the group, the lock is recursive
+    void Lock()
+    {
+      pthread_mutex_lock(&lock);
+    }
+
+    void Unlock()
+    {
+      pthread_mutex_unlock(&lock);
+    }
+};
+
+/**
+ * Holds the group lock for the lifetime of the object
+ */
+class ShardLock {
+  private:
+    ShardGroup *group;
+
+  public:
+    ShardLock(ShardGroup *group): group(group)
+    {
+      group->Lock();
+    }
+
+    ~ShardLock()
+    {
+      group->Unlock();
+    }
+};
+
+/**
+ * All informations known about a set of computers.
+ */
+class ComputerInfoList : public Observable<const AnalysisInfo> {
+  // Attributes
+  private:
+    /// Informations about packet timing
+    std::list<ComputerInfo *> computers;
+    /// Computers of this shard indexed by their address (and port)
+    HostIndex index;
+    /// Informations about clock skew
+    // clock_skew_guard skews;
+    /**
+     * Computers ordered by the time of their last packet, the least recently
+     * active first. Computers probed by ICMP are added with their first reply.
+     */
+    std::list<ComputerInfo *> idle;
+    std::string type;
+    /// Group of shards that this list belongs to
+    ShardGroup *group;
+    /// True if the group was created by (and belongs to) this list
+    bool ownGroup;
+    /// True if the list is filled by more workers, each packet is processed under the group lock
+    bool concurrent;
+
     // Private methods
   private:
     void construct_notify(const std::string &ip, const identity_container &identitites, const TimeSegmentList &s) const;
+    /// Notifies observers about the current skew and similar computers of a computer
+    void construct_notify(ComputerInfo *computer);
     void construct_notify(const std::string &ip) const;
+
+    /**
+     * Finds saved computers similar to a skew, only a constant skew is
+     * searched, the group lock has to be held
+     * @param[in] skew Skew to be searched
+     * @param[out] names Names of the similar saved computers are added here
+     */
+    void find_saved(const TimeSegmentList &skew, identity_container &names);
+
+    /**
+     * Writes computers into the shared live state, the group lock has to be held
+     * @param[in] owned Computer of this shard whose skew changed or NULL
+     * @param[in] changed Computers of any shard whose cluster may have changed
+     */
+    void publish_state(ComputerInfo *owned, const std::vector<ComputerInfo *> &changed);
     
-    TimeSegmentList * getSkew(std::string ip);
+    /**
+     * Finds a computer in all shards of the group
+     * @param[in] ip Address of the computer (text form of its key)
+     * @return Computer or NULL if not known
+     */
+    ComputerInfo * find_computer(const std::string &ip) const;
+
+    /**
+     * Processes a packet of a known computer
+     * @param[in] known_computer Computer that sent the packet
+     * @param[in] time Real time when packet arrived
+     * @param[in] timestamp Timestamp of the packet
+     */
+    void known_packet(ComputerInfo &known_computer, double time, uint64_t timestamp);
+
+    /**
+     * Keeps packets of the computer under HOST_MEMORY_LIMIT, packets that
+     * cannot change the clock skew are dropped first, the tracking is
+     * restarted if they do not bring the memory under 3/4 of the limit
+     */
+    void enforce_memory_limit(ComputerInfo &computer);
+
+    /**
+     * Moves the computer to the end of the idle list
+     */
+    void touch(ComputerInfo &computer);
+
+    /**
+     * Removes computers that have been inactive for more than timeLimit, only
+     * the beginning of the idle list is inspected
+     * @param[in] time Current time
+     */
+    void expire_inactive(double time);
 
   // Constructors
   public:
-    ComputerInfoList(std::string type): last_inactive(time(NULL)), type(type), lastXMLupdate(0)
-    {}
+    /**
+     * @param[in] type Type of the timestamps (tcp, icmp, javascript)
+     * @param[in] group Group of shards to join, NULL for a standalone list
+     * @param[in] concurrent True if more capture workers insert packets into this list
+     */
+    ComputerInfoList(std::string type, ShardGroup *group = NULL, bool concurrent = false);
     
     ~ComputerInfoList();
 
@@ -66,16 +200,27 @@ class ComputerInfoList : public Observable<const AnalysisInfo> {
         return type + "/";
     }
 
+    ShardGroup * get_group() const
+    {
+      return group;
+    }
+
+    /// Computers of this shard, the group lock has to be held by other workers
+    const std::list<ComputerInfo *> & get_computers() const
+    {
+      return computers;
+    }
+
   // Public methods
   public:
     /**
      * New packet processing (classify, save, compute...)
-     * @param[in] address IP address of the source
+     * @param[in] key Address of the source, port is set only if ports are distinguished
      * @param[in] time Real time when packet arrived
      * @param[in] timestamp PCAP timestamp of the packet
      * @return 0 if new IP address, 1 if computer already known
      */
-    bool new_packet(const char *address, u_int16_t port, double time, uint64_t timestamp);
+    bool new_packet(const AddressKey &key, double time, uint64_t timestamp);
 
     /**
      * Registers a new observer for clock changes
@@ -110,15 +255,17 @@ class ComputerInfoList : public Observable<const AnalysisInfo> {
      */
     void save_active_computers();
     /**
-     * Saves log files to disk
+     * Saves log files of this shard to disk
      */
     void save_log();
 
     /**
      * Starts ICMP active probing of the given IP address.
-     * @param[in] address The IP address selected for ICMP active probing.
+     * @param[in] key The IPv4 address selected for ICMP active probing (without port).
+     * @param[in] ttime Time of the packet that revealed the address, the
+     * computer expires if it does not reply within the time limit
      */
-    void to_poke_or_not_to_poke(std::string address);
+    void to_poke_or_not_to_poke(const AddressKey &key, double ttime);
 
 };
 
@@ -18,6 +18,7 @@
  * along with pcf. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
@@ -70,17 +71,33 @@ void Configurator::Init()
   
   strcpy(active, "active.xml");
   strcpy(database, "database.xml");
+  strcpy(store, "database.pcfs");
   
   block = 100;
   timeLimit = 3600;
   threshold = 0.001;
   reduce = false;
+  retainHullOnly = false;
   xmlRefreshLimit = 60;
   
   setFreq = 0;
   bashOutput = false;
   setSkew = std::numeric_limits<double>::infinity();
   outFile = "";
+
+  ring = false;
+  ringBlockSize = 1 << 22;
+  ringBlockCount = 64;
+  ringFrameSize = 1 << 11;
+  workers = 1;
+
+  hostMemoryLimit = 0;
+  outputQueueLimit = 64 << 20;
+  graphInterval = 10;
+  eventQueueSize = 1024;
+  exportOverflow = "block";
+  sharedState = "";
+  sharedStateHosts = 16384;
 }
 
 /**
@@ -220,6 +237,14 @@ void Configurator::GetConfig(const char *filename)
       else if (strcmp(name, "database") == 0)
         strncpy(database, value, strlen(value));
       
+      // store
+      else if (strcmp(name, "store") == 0) {
+        // A longer name is truncated
+        size_t length = std::min(strlen(value), sizeof(store) - 1);
+        memcpy(store, value, length);
+        store[length] = '\0';
+      }
+      
       // BLOCK
       else if (strcmp(name, "BLOCK") == 0) {
         block = atoi(value);
@@ -242,6 +267,64 @@ void Configurator::GetConfig(const char *filename)
       else if (strcmp(name, "REFRESH_TIME_LIMIT") == 0) {
         xmlRefreshLimit = atof(value);
       }
+      // RING_BLOCK_SIZE
+      else if (strcmp(name, "RING_BLOCK_SIZE") == 0) {
+        ringBlockSize = atoi(value);
+        if (ringBlockSize == 0)
+          ringBlockSize = 1 << 22;
+      }
+      // RING_BLOCK_COUNT
+      else if (strcmp(name, "RING_BLOCK_COUNT") == 0) {
+        ringBlockCount = atoi(value);
+        if (ringBlockCount == 0)
+          ringBlockCount = 64;
+      }
+      // RING_FRAME_SIZE
+      else if (strcmp(name, "RING_FRAME_SIZE") == 0) {
+        ringFrameSize = atoi(value);
+        if (ringFrameSize == 0)
+          ringFrameSize = 1 << 11;
+      }
+      // WORKERS
+      else if (strcmp(name, "WORKERS") == 0) {
+        workers = atoi(value);
+        if (workers == 0)
+          workers = 1;
+      }
+      // HOST_MEMORY_LIMIT
+      else if (strcmp(name, "HOST_MEMORY_LIMIT") == 0) {
+        hostMemoryLimit = strtoul(value, NULL, 10);
+      }
+      // OUTPUT_QUEUE_LIMIT
+      else if (strcmp(name, "OUTPUT_QUEUE_LIMIT") == 0) {
+        outputQueueLimit = strtoul(value, NULL, 10);
+        if (outputQueueLimit == 0)
+          outputQueueLimit = 64 << 20;
+      }
+      // GRAPH_INTERVAL
+      else if (strcmp(name, "GRAPH_INTERVAL") == 0) {
+        graphInterval = atof(value);
+      }
+      // EVENT_QUEUE_SIZE
+      else if (strcmp(name, "EVENT_QUEUE_SIZE") == 0) {
+        eventQueueSize = strtoul(value, NULL, 10);
+        if (eventQueueSize == 0)
+          eventQueueSize = 1024;
+      }
+      // EXPORT_OVERFLOW
+      else if (strcmp(name, "EXPORT_OVERFLOW") == 0) {
+        exportOverflow = value;
+      }
+      // SHARED_STATE
+      else if (strcmp(name, "SHARED_STATE") == 0) {
+        sharedState = value;
+      }
+      // SHARED_STATE_HOSTS
+      else if (strcmp(name, "SHARED_STATE_HOSTS") == 0) {
+        sharedStateHosts = strtoul(value, NULL, 10);
+        if (sharedStateHosts == 0)
+          sharedStateHosts = 16384;
+      }
     }
   }
   
@@ -42,6 +42,7 @@ public:
   bool exportSkewChanges;
   std::string datafile;
   bool reduce;
+  bool retainHullOnly;
     
   char dev[10];
   std::string datalink;
@@ -56,6 +57,7 @@ public:
   
   char active[1024];
   char database[1024];
+  char store[1024];
   static const std::string xmlDir;
   
   int block;
@@ -67,6 +69,20 @@ public:
   bool bashOutput;
   double setSkew;
   std::string outFile;
+
+  bool ring;
+  unsigned int ringBlockSize;
+  unsigned int ringBlockCount;
+  unsigned int ringFrameSize;
+  unsigned int workers;
+
+  size_t hostMemoryLimit;
+  size_t outputQueueLimit;
+  double graphInterval;
+  size_t eventQueueSize;
+  std::string exportOverflow;
+  std::string sharedState;
+  unsigned int sharedStateHosts;
   
   void Init();
 
@@ -0,0 +1,231 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <unordered_map>
+
+#include "EventBus.h"
+
+EventBus::Subscriber::Subscriber(Observer<const AnalysisInfo> *obs, OverflowPolicy overflow, size_t capacity):
+  observer(obs), policy(overflow), queue(capacity), waiting(false), blocked(0),
+  stopping(false), outstanding(0), posted(0), dropped(0), coalesced(0), waits(0)
+{
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&ready, NULL);
+  pthread_cond_init(&space, NULL);
+  pthread_cond_init(&drained, NULL);
+}
+
+EventBus::Subscriber::~Subscriber()
+{
+  pthread_cond_destroy(&drained);
+  pthread_cond_destroy(&space);
+  pthread_cond_destroy(&ready);
+  pthread_mutex_destroy(&lock);
+}
+
+EventBus::~EventBus()
+{
+  for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+    Subscriber &subscriber = **it;
+    pthread_mutex_lock(&subscriber.lock);
+    subscriber.stopping = true;
+    pthread_cond_signal(&subscriber.ready);
+    pthread_mutex_unlock(&subscriber.lock);
+    pthread_join(subscriber.thread, NULL);
+    delete *it;
+  }
+}
+
+void EventBus::Subscribe(Observer<const AnalysisInfo> *observer, OverflowPolicy policy, size_t capacity)
+{
+  Subscriber *subscriber = new Subscriber(observer, policy, capacity);
+  if (pthread_create(&subscriber->thread, NULL, ConsumerThread, subscriber) != 0) {
+    std::cerr << "Cannot start the observer thread" << std::endl;
+    exit(2);
+  }
+  subscribers.push_back(subscriber);
+}
+
+void EventBus::Notify(std::string activity, const AnalysisInfo& changed_skew)
+{
+  if (subscribers.empty()) {
+    return;
+  }
+  // One copy of the skew is shared by all observers
+  event_ptr event = std::make_shared<AnalysisEvent>(activity, changed_skew);
+  for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+    Post(**it, event);
+  }
+}
+
+void EventBus::Post(Subscriber &subscriber, const event_ptr &event)
+{
+  subscriber.posted++;
+  subscriber.outstanding++;
+  while (!subscriber.queue.Push(event)) {
+    if (subscriber.policy == OVERFLOW_DROP_OLDEST) {
+      event_ptr oldest;
+      if (subscriber.queue.Pop(oldest)) {
+        subscriber.dropped++;
+        // Never reaches zero, the new event is counted
+        subscriber.outstanding--;
+      }
+      continue;
+    }
+
+    // The consumer wakes blocked producers after each event it takes
+    subscriber.waits++;
+    pthread_mutex_lock(&subscriber.lock);
+    subscriber.blocked++;
+    while (!subscriber.queue.Push(event)) {
+      pthread_cond_wait(&subscriber.space, &subscriber.lock);
+    }
+    subscriber.blocked--;
+    pthread_mutex_unlock(&subscriber.lock);
+    break;
+  }
+
+  // Either the consumer sees the event or we see that it is waiting
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (subscriber.waiting.load()) {
+    pthread_mutex_lock(&subscriber.lock);
+    pthread_cond_signal(&subscriber.ready);
+    pthread_mutex_unlock(&subscriber.lock);
+  }
+}
+
+void EventBus::WakeProducers(Subscriber &subscriber)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (subscriber.blocked.load() > 0) {
+    pthread_mutex_lock(&subscriber.lock);
+    pthread_cond_broadcast(&subscriber.space);
+    pthread_mutex_unlock(&subscriber.lock);
+  }
+}
+
+void EventBus::Done(Subscriber &subscriber)
+{
+  if (--subscriber.outstanding == 0) {
+    pthread_mutex_lock(&subscriber.lock);
+    pthread_cond_broadcast(&subscriber.drained);
+    pthread_mutex_unlock(&subscriber.lock);
+  }
+}
+
+void * EventBus::ConsumerThread(void *arg)
+{
+  Subscriber &subscriber = *static_cast<Subscriber *>(arg);
+  // Coalesced events waiting for the delivery in the order of their arrival
+  std::list<event_ptr> pending;
+  std::unordered_map<std::string, std::list<event_ptr>::iterator> pendingAddresses;
+  event_ptr event;
+
+  while (true) {
+    if (subscriber.policy == OVERFLOW_COALESCE) {
+      // The queue is emptied before every delivery so that the latest event
+      // of each address replaces the older ones
+      while (subscriber.queue.Pop(event)) {
+        WakeProducers(subscriber);
+        auto found = pendingAddresses.find(event->Address);
+        if (found != pendingAddresses.end()) {
+          found->second->swap(event);
+          subscriber.coalesced++;
+          Done(subscriber);
+        }
+        else {
+          pending.push_back(event);
+          pendingAddresses[event->Address] = std::prev(pending.end());
+        }
+      }
+      if (!pending.empty()) {
+        event.swap(pending.front());
+        pendingAddresses.erase(event->Address);
+        pending.pop_front();
+      }
+    }
+    else if (subscriber.queue.Pop(event)) {
+      WakeProducers(subscriber);
+    }
+
+    if (event) {
+      subscriber.observer->Notify(event->Activity, event->Info);
+      event.reset();
+      Done(subscriber);
+      continue;
+    }
+
+    // Sleep until a producer queues an event
+    pthread_mutex_lock(&subscriber.lock);
+    subscriber.waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (subscriber.queue.Empty() && !subscriber.stopping) {
+      pthread_cond_wait(&subscriber.ready, &subscriber.lock);
+    }
+    subscriber.waiting.store(false);
+    bool stop = subscriber.stopping && subscriber.queue.Empty();
+    pthread_mutex_unlock(&subscriber.lock);
+    if (stop) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+void EventBus::Flush()
+{
+  for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+    Subscriber &subscriber = **it;
+    pthread_mutex_lock(&subscriber.lock);
+    while (subscriber.outstanding.load() != 0) {
+      pthread_cond_wait(&subscriber.drained, &subscriber.lock);
+    }
+    pthread_mutex_unlock(&subscriber.lock);
+  }
+}
+
+void EventBus::PrintStatistics() const
+{
+  for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+    const Subscriber &subscriber = **it;
+    std::cerr << "Event bus observer statistics: " << subscriber.posted << " events, " <<
+      subscriber.dropped << " dropped, " << subscriber.coalesced << " coalesced, " <<
+      subscriber.waits << " times the producer waited" << std::endl;
+  }
+}
+
+bool EventBus::ParsePolicy(const std::string &name, OverflowPolicy &policy)
+{
+  if (name == "block") {
+    policy = OVERFLOW_BLOCK;
+  }
+  else if (name == "drop_oldest") {
+    policy = OVERFLOW_DROP_OLDEST;
+  }
+  else if (name == "coalesce") {
+    policy = OVERFLOW_COALESCE;
+  }
+  else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EVENT_BUS_H
+#define _EVENT_BUS_H
+
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "AnalysisInfo.h"
+#include "EventQueue.h"
+#include "Observer.h"
+
+/**
+ * Immutable notification shared by all observers of an event bus
+ */
+class AnalysisEvent {
+  public:
+    const std::string Activity;
+    const std::string Address;
+    /// Refers to Address of the event
+    const AnalysisInfo Info;
+
+    AnalysisEvent(const std::string &activity, const AnalysisInfo &changed_skew):
+      Activity(activity), Address(changed_skew.Address),
+      Info{Address, changed_skew.SimilarIdentities, changed_skew.ClockSkewList}
+    {}
+
+  private:
+    AnalysisEvent(const AnalysisEvent &);
+    AnalysisEvent & operator=(const AnalysisEvent &);
+};
+
+/// What a producer does when the queue of an observer is full
+enum OverflowPolicy {
+  /// Wait until the observer catches up
+  OVERFLOW_BLOCK,
+  /// Drop the oldest queued event
+  OVERFLOW_DROP_OLDEST,
+  /// Only the latest event of each address is delivered, the producer waits
+  /// if the queue is still full
+  OVERFLOW_COALESCE
+};
+
+/**
+ * Asynchronous dispatch of notifications. The bus is registered as an
+ * observer of computer lists instead of slow observers, each notification is
+ * copied once into an immutable event that is queued for every subscribed
+ * observer. Each observer has a bounded lock-free queue and its own thread,
+ * so a slow observer (gnuplot, a stdout exporter writing into a slow pipe)
+ * does not throttle the capture, it only affects its own events.
+ *
+ * Observers are subscribed before the first notification.
+ */
+class EventBus: public Observer<const AnalysisInfo>
+{
+  // Private types
+  private:
+    typedef std::shared_ptr<const AnalysisEvent> event_ptr;
+
+    struct Subscriber {
+      Observer<const AnalysisInfo> *observer;
+      OverflowPolicy policy;
+      EventQueue<event_ptr> queue;
+      pthread_t thread;
+
+      pthread_mutex_t lock;
+      /// Signalled when an event is queued for a waiting consumer
+      pthread_cond_t ready;
+      /// Signalled when a blocked producer can retry
+      pthread_cond_t space;
+      /// Signalled when all events are delivered
+      pthread_cond_t drained;
+      std::atomic<bool> waiting;
+      std::atomic<unsigned int> blocked;
+      bool stopping;
+
+      /// Events that were not delivered, dropped or coalesced yet
+      std::atomic<size_t> outstanding;
+
+      // Statistics
+      std::atomic<unsigned long> posted;
+      std::atomic<unsigned long> dropped;
+      std::atomic<unsigned long> coalesced;
+      std::atomic<unsigned long> waits;
+
+      Subscriber(Observer<const AnalysisInfo> *obs, OverflowPolicy overflow, size_t capacity);
+      ~Subscriber();
+    };
+
+  // Attributes
+  private:
+    std::vector<Subscriber *> subscribers;
+
+  // Constructors, destructors
+  public:
+    EventBus(): subscribers() {}
+    /// Delivers queued events and stops the threads of observers
+    ~EventBus();
+
+  private:
+    EventBus(const EventBus &);
+    EventBus & operator=(const EventBus &);
+
+  // Public methods
+  public:
+    /**
+     * Subscribes an observer and starts its thread
+     * @param[in] observer Observer to be notified asynchronously
+     * @param[in] policy What to do when the queue of the observer is full
+     * @param[in] capacity Number of queued events
+     */
+    void Subscribe(Observer<const AnalysisInfo> *observer, OverflowPolicy policy, size_t capacity);
+
+    virtual void Notify(std::string activity, const AnalysisInfo& changed_skew);
+
+    /// Waits until all queued events are delivered
+    void Flush();
+
+    /// Prints statistics of all observers to stderr
+    void PrintStatistics() const;
+
+    /**
+     * Parses the name of an overflow policy
+     * @param[in] name block, drop_oldest or coalesce
+     * @param[out] policy Parsed policy
+     * @return false if the name is not known
+     */
+    static bool ParsePolicy(const std::string &name, OverflowPolicy &policy);
+
+  // Private methods
+  private:
+    static void Post(Subscriber &subscriber, const event_ptr &event);
+
+    static void * ConsumerThread(void *subscriber);
+
+    /// Wakes producers blocked on a full queue
+    static void WakeProducers(Subscriber &subscriber);
+
+    /// Marks an event as processed
+    static void Done(Subscriber &subscriber);
+};
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EVENT_QUEUE_H
+#define _EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Bounded lock-free queue (the array queue of Dmitry Vyukov). Each cell
+ * carries a sequence number that tells whether the cell is free for the
+ * producer or filled for the consumer of the given position, so producers
+ * and consumers only compete for the position counters.
+ *
+ * Any thread may push and pop. The event bus uses one consumer per queue,
+ * producers pop only to drop the oldest event of a full queue.
+ */
+template <class T>
+class EventQueue
+{
+  // Private types
+  private:
+    struct Cell {
+      std::atomic<size_t> sequence;
+      T data;
+    };
+
+  // Attributes
+  private:
+    Cell *cells;
+    size_t mask;
+    /// Producers and the consumer do not share cache lines of positions
+    char padding1[64];
+    std::atomic<size_t> enqueuePos;
+    char padding2[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePos;
+    char padding3[64 - sizeof(std::atomic<size_t>)];
+
+  // Constructors, destructors
+  public:
+    /**
+     * Constructor
+     * @param[in] capacity Number of events, rounded up to a power of two
+     */
+    EventQueue(size_t capacity): enqueuePos(0), dequeuePos(0)
+    {
+      size_t size = 2;
+      while (size < capacity) {
+        size <<= 1;
+      }
+      cells = new Cell[size];
+      mask = size - 1;
+      for (size_t i = 0; i < size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    ~EventQueue()
+    {
+      delete [] cells;
+    }
+
+  private:
+    EventQueue(const EventQueue &);
+    EventQueue & operator=(const EventQueue &);
+
+  // Public methods
+  public:
+    /**
+     * Appends an event
+     * @param[in] value Event to be appended
+     * @return false if the queue is full
+     */
+    bool Push(const T &value)
+    {
+      size_t pos = enqueuePos.load(std::memory_order_relaxed);
+      Cell *cell;
+      while (true) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+        if (diff == 0) {
+          if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        }
+        else if (diff < 0) {
+          return false;
+        }
+        else {
+          pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+      cell->data = value;
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Removes the oldest event
+     * @param[out] value The removed event
+     * @return false if the queue is empty
+     */
+    bool Pop(T &value)
+    {
+      size_t pos = dequeuePos.load(std::memory_order_relaxed);
+      Cell *cell;
+      while (true) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos + 1);
+        if (diff == 0) {
+          if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        }
+        else if (diff < 0) {
+          return false;
+        }
+        else {
+          pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+      }
+      value = cell->data;
+      // The cell does not keep the event alive
+      cell->data = T();
+      cell->sequence.store(pos + mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// True if the oldest event has not been pushed completely yet
+    bool Empty() const
+    {
+      size_t pos = dequeuePos.load(std::memory_order_acquire);
+      return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FingerprintStore.h"
+
+const char FingerprintStore::MAGIC[8] = {'P', 'C', 'F', 'S', 'T', 'O', 'R', 'E'};
+
+FingerprintStore::~FingerprintStore()
+{
+  Close();
+}
+
+void FingerprintStore::Close()
+{
+  if (mapping != NULL) {
+    munmap(mapping, mappingSize);
+    mapping = NULL;
+    mappingSize = 0;
+  }
+  buffer.clear();
+  records = NULL;
+  count = 0;
+  strings = NULL;
+  stringsSize = 0;
+}
+
+int FingerprintStore::Open(const std::string &filename)
+{
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 2;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(Header)) {
+    close(fd);
+    return 2;
+  }
+  void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return 2;
+  }
+
+  const Header *header = (const Header *) mapped;
+  size_t size = info.st_size;
+  // Only the header is checked, records are not touched until they are searched
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+      header->recordSize != sizeof(Record) ||
+      header->count > (size - sizeof(Header)) / sizeof(Record) ||
+      header->stringsSize != size - sizeof(Header) - header->count * sizeof(Record) ||
+      (header->stringsSize > 0 && ((const char *) mapped)[size - 1] != '\0')) {
+    munmap(mapped, size);
+    return 2;
+  }
+
+  mapping = mapped;
+  mappingSize = size;
+  records = (const Record *) ((const char *) mapped + sizeof(Header));
+  count = header->count;
+  strings = (const char *) (records + count);
+  stringsSize = header->stringsSize;
+  return 0;
+}
+
+/// Appends a string to the table, empty strings share the first byte
+static uint32_t add_string(std::string &table, const std::string &s)
+{
+  if (s.empty()) {
+    return 0;
+  }
+  uint32_t offset = table.size();
+  table.append(s.c_str(), s.size() + 1);
+  return offset;
+}
+
+int FingerprintStore::Build(const std::vector<SavedComputer> &computers)
+{
+  Close();
+
+  std::vector<SavedComputer> sorted(computers);
+  std::stable_sort(sorted.begin(), sorted.end());
+
+  std::string table(1, '\0');
+  std::vector<Record> built(sorted.size());
+  for (size_t i = 0; i < sorted.size(); i++) {
+    Record &record = built[i];
+    record.skew = sorted[i].skew;
+    record.frequency = sorted[i].frequency;
+    record.name = add_string(table, sorted[i].name);
+    record.address = add_string(table, sorted[i].address);
+    record.date = add_string(table, sorted[i].date);
+    record.reserved = 0;
+    if (table.size() > UINT32_MAX) {
+      return 2;
+    }
+  }
+
+  buffer.resize(built.size() * sizeof(Record) + table.size());
+  if (!built.empty()) {
+    memcpy(buffer.data(), built.data(), built.size() * sizeof(Record));
+  }
+  memcpy(buffer.data() + built.size() * sizeof(Record), table.data(), table.size());
+
+  records = (const Record *) buffer.data();
+  count = built.size();
+  strings = buffer.data() + count * sizeof(Record);
+  stringsSize = table.size();
+  return 0;
+}
+
+int FingerprintStore::Write(const std::string &filename) const
+{
+  Header header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.recordSize = sizeof(Record);
+  header.count = count;
+  header.stringsSize = stringsSize;
+
+  std::string temporary = filename + ".tmp";
+  FILE *f = fopen(temporary.c_str(), "wb");
+  if (f == NULL) {
+    return 2;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+    (count == 0 || fwrite(records, sizeof(Record), count, f) == count) &&
+    (stringsSize == 0 || fwrite(strings, stringsSize, 1, f) == 1);
+  if (fclose(f) != 0 || !written || rename(temporary.c_str(), filename.c_str()) != 0) {
+    unlink(temporary.c_str());
+    return 2;
+  }
+  return 0;
+}
+
+void FingerprintStore::Get(size_t i, SavedComputer &computer) const
+{
+  const Record &record = records[i];
+  computer.skew = record.skew;
+  computer.frequency = record.frequency;
+  computer.name = String(record.name);
+  computer.address = String(record.address);
+  computer.date = String(record.date);
+}
+
+void FingerprintStore::Find(double skew, double threshold, identity_container &identities) const
+{
+  const Record *end = records + count;
+  const Record *it = std::lower_bound(records, end, skew - threshold,
+      [](const Record &record, double value) { return record.skew < value; });
+  for (; it != end && it->skew <= skew + threshold; ++it) {
+    if (std::fabs(skew - it->skew) < threshold) {
+      identities.insert(String(it->name));
+    }
+  }
+}
@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FINGERPRINT_STORE_H
+#define _FINGERPRINT_STORE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "TimeSegment.h"
+
+/**
+ * Computer saved in the database of known computers
+ */
+struct SavedComputer {
+  double skew;
+  std::string name;
+  std::string address;
+  double frequency;
+  std::string date;
+
+  bool operator<(const SavedComputer &other) const
+  {
+    return skew < other.skew;
+  }
+};
+
+/**
+ * Binary database of known computers (database.pcfs), it is mapped into
+ * memory and used without parsing.
+ *
+ * The file starts with a header (the 8 byte magic "PCFSTORE", uint32
+ * version, uint32 record size, uint64 number of records, uint64 size of the
+ * string table) followed by fixed size records sorted by skew and by the
+ * string table. Strings are terminated by zero, records refer to them by
+ * their offset in the table. All fields are in the host byte order.
+ *
+ * A store may also be built in memory, e.g. from database.xml. A written
+ * store replaces the file by rename, so mappings of the old file stay valid.
+ */
+class FingerprintStore {
+  // Constants
+  public:
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+
+  // Public types
+  public:
+    struct Record {
+      double skew;
+      double frequency;
+      uint32_t name;
+      uint32_t address;
+      uint32_t date;
+      uint32_t reserved;
+    };
+
+  // Private types
+  private:
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t recordSize;
+      uint64_t count;
+      uint64_t stringsSize;
+    };
+
+  // Attributes
+  private:
+    /// Mapped file, NULL for a store built in memory
+    void *mapping;
+    size_t mappingSize;
+    /// Content of a store built in memory
+    std::vector<char> buffer;
+
+    const Record *records;
+    size_t count;
+    const char *strings;
+    size_t stringsSize;
+
+  // Constructors, destructors
+  public:
+    FingerprintStore(): mapping(NULL), mappingSize(0), buffer(), records(NULL), count(0),
+      strings(NULL), stringsSize(0) {}
+
+    ~FingerprintStore();
+
+  private:
+    // The store owns its mapping
+    FingerprintStore(const FingerprintStore &);
+    FingerprintStore & operator=(const FingerprintStore &);
+
+  // Public methods
+  public:
+    /**
+     * Maps a binary database
+     * @param[in] filename Name of the file
+     * @return 0 if ok, 2 if the file cannot be mapped or it is not a store of this version
+     */
+    int Open(const std::string &filename);
+
+    /**
+     * Builds the store in memory
+     * @param[in] computers Saved computers in any order
+     * @return 0 if ok, 2 if the strings do not fit into the string table
+     */
+    int Build(const std::vector<SavedComputer> &computers);
+
+    /**
+     * Writes the store into a file, the file is replaced atomically
+     * @return 0 if ok
+     */
+    int Write(const std::string &filename) const;
+
+    size_t size() const
+    {
+      return count;
+    }
+
+    /// Returns a string of the string table, an invalid offset gives ""
+    const char * String(uint32_t offset) const
+    {
+      return offset < stringsSize ? strings + offset : "";
+    }
+
+    /// Decodes a record
+    void Get(size_t i, SavedComputer &computer) const;
+
+    /**
+     * Finds saved computers with a similar skew
+     * @param[in] skew Skew to be searched
+     * @param[in] threshold Threshold for the similar skew
+     * @param[inout] identities Names of similar computers are added here
+     */
+    void Find(double skew, double threshold, identity_container &identities) const;
+
+  // Private methods
+  private:
+    void Close();
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FREQUENCY_ESTIMATOR_H
+#define _FREQUENCY_ESTIMATOR_H
+
+#include <cmath>
+
+/// Packets that arrived later after the first packet estimate the frequency (seconds)
+const double FREQ_ESTIMATE_AFTER = 60.0;
+
+/**
+ * Running estimate of the frequency of timestamps of a computer. Packets are
+ * added relative to the first packet, each addition costs O(1).
+ *
+ * Two estimates are kept:
+ *  - the mean of timestamp rates of packets that arrived more than
+ *    FREQ_ESTIMATE_AFTER seconds after the first packet,
+ *  - least squares line of timestamps over arrival times (updated by the
+ *    Welford's method to avoid cancellation), its standard error tells how
+ *    confident the estimate is before FREQ_ESTIMATE_AFTER elapses.
+ */
+class FrequencyEstimator {
+  private:
+    /// Number of packets needed for an estimate
+    static const unsigned long MIN_PACKETS = 10;
+
+    double rateSum;
+    unsigned long rateCount;
+
+    unsigned long count;
+    double meanTime;
+    double meanTicks;
+    /// Sums of squared deviations from the means (times, ticks) and of their products
+    double timeM2;
+    double ticksM2;
+    double coM2;
+
+  public:
+    FrequencyEstimator()
+    {
+      clear();
+    }
+
+    void clear()
+    {
+      rateSum = 0.0;
+      rateCount = 0;
+      count = 0;
+      meanTime = meanTicks = 0.0;
+      timeM2 = ticksM2 = coM2 = 0.0;
+    }
+
+    /**
+     * Adds a packet
+     * @param[in] time Arrival time since the first packet
+     * @param[in] ticks Timestamp difference to the first packet
+     */
+    void add(double time, double ticks)
+    {
+      if (time > FREQ_ESTIMATE_AFTER) {
+        rateSum += ticks / time;
+        rateCount++;
+      }
+
+      count++;
+      double time_delta = time - meanTime;
+      double ticks_delta = ticks - meanTicks;
+      meanTime += time_delta / count;
+      meanTicks += ticks_delta / count;
+      timeM2 += time_delta * (time - meanTime);
+      ticksM2 += ticks_delta * (ticks - meanTicks);
+      coM2 += time_delta * (ticks - meanTicks);
+    }
+
+    /**
+     * Returns the mean rate of packets that arrived after FREQ_ESTIMATE_AFTER
+     * snapped to a common frequency, 0 if there are not enough packets
+     */
+    int mean_frequency() const
+    {
+      if (rateCount < MIN_PACKETS) {
+        return 0;
+      }
+      return Snap((int) round(rateSum / rateCount));
+    }
+
+    /**
+     * Returns a common frequency if the least squares estimate is within its
+     * tolerance with confidence of three standard errors, 0 otherwise
+     */
+    int confident_frequency() const
+    {
+      if (count < MIN_PACKETS || timeM2 <= 0.0) {
+        return 0;
+      }
+      double slope = coM2 / timeM2;
+      double residuals = ticksM2 - slope * coM2;
+      if (residuals < 0.0) {
+        residuals = 0.0;
+      }
+      double error = 3 * std::sqrt(residuals / (count - 2) / timeM2);
+      if (slope - error < 0.0 || slope + error > 100000000) {
+        return 0;
+      }
+      int low = CommonFrequency((int) round(slope - error));
+      int high = CommonFrequency((int) round(slope + error));
+      if (low == 0 || low != high) {
+        // The interval is not within a tolerance of one common frequency
+        return 0;
+      }
+      return low;
+    }
+
+    /**
+     * Returns the common frequency whose tolerance contains the measured
+     * frequency, 0 if there is none
+     * According to the real world, but sometimes can be wrong, it depends...
+     */
+    static int CommonFrequency(int freq)
+    {
+      if (freq >= 970 && freq <= 1030)
+        return 1000;
+      else if (freq >= 95 && freq <= 105)
+        return 100;
+      else if (freq >= 230 && freq <= 270)
+        return 250;
+      else if (freq >= 9990000 && freq <= 10010000)
+        return 10000000;
+      return 0;
+    }
+
+    /// Snaps a measured frequency to a common one if it is close enough
+    static int Snap(int freq)
+    {
+      int common = CommonFrequency(freq);
+      return (common != 0) ? common : freq;
+    }
+};
+
+#endif
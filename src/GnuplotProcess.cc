@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+
+#include "GnuplotProcess.h"
+
+GnuplotProcess::~GnuplotProcess()
+{
+  Stop();
+}
+
+bool GnuplotProcess::Start()
+{
+  // A gnuplot that exited must not kill pcf by SIGPIPE
+  signal(SIGPIPE, SIG_IGN);
+  pipe = popen("gnuplot", "w");
+  if (pipe == NULL) {
+    fprintf(stderr, "Error while launching gnuplot\n");
+    return false;
+  }
+  starts++;
+  return true;
+}
+
+void GnuplotProcess::Stop()
+{
+  if (pipe != NULL) {
+    pclose(pipe);
+    pipe = NULL;
+  }
+}
+
+bool GnuplotProcess::Plot(const std::string &script)
+{
+  // The output file is closed so that the graph is complete, settings of
+  // the script are reset before the next graph
+  std::string commands = "load '" + script + "'\nunset output\nreset\n";
+
+  // The process may have exited since the last graph, it is started again once
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (pipe == NULL && !Start()) {
+      return false;
+    }
+    if (fputs(commands.c_str(), pipe) >= 0 && fflush(pipe) == 0) {
+      return true;
+    }
+    Stop();
+  }
+  fprintf(stderr, "Error while sending %s to gnuplot\n", script.c_str());
+  return false;
+}
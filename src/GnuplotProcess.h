@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNUPLOT_PROCESS_H
+#define _GNUPLOT_PROCESS_H
+
+#include <cstdio>
+#include <string>
+
+/**
+ * Long-lived gnuplot process fed over a pipe, scripts are loaded by the
+ * running process instead of starting gnuplot for every graph. The process
+ * is started with the first graph and restarted if it exits or
+ * after it was stopped.
+ *
+ * The class is not thread safe, it is used by the output thread only.
+ */
+class GnuplotProcess {
+  // Attributes
+  private:
+    FILE *pipe;
+    /// Number of started processes
+    unsigned long starts;
+
+  // Constructors, destructors
+  public:
+    GnuplotProcess(): pipe(NULL), starts(0) {}
+    ~GnuplotProcess();
+
+  // Public methods
+  public:
+    /**
+     * Plots a gnuplot script
+     * @param[in] script Filename of the script
+     * @return true if the script was passed to gnuplot
+     */
+    bool Plot(const std::string &script);
+
+    /// Closes the pipe and waits until gnuplot finishes all loaded graphs
+    void Stop();
+
+    unsigned long get_starts() const
+    {
+      return starts;
+    }
+
+  // Private methods
+  private:
+    bool Start();
+};
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <utility>
+
+#include "AddressKey.h"
+#include "Configurator.h"
+#include "GraphScheduler.h"
+
+/// The list of viewed hosts is checked at most once per second
+const double VIEWED_CHECK_INTERVAL = 1.0;
+
+static double monotonic_time()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+GraphScheduler::GraphScheduler(Observer<const AnalysisInfo> &graph):
+  target(graph), hosts(), schedule(), viewed(), viewedModified(0),
+  viewedChecked(-VIEWED_CHECK_INTERVAL), flushing(false), busy(false),
+  stopping(false), notified(0), drawn(0)
+{
+  pthread_mutex_init(&lock, NULL);
+  // Waiting for the interval is not affected by changes of the system time
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&changed, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&drained, NULL);
+  if (pthread_create(&worker, NULL, WorkerThread, this) != 0) {
+    std::cerr << "Cannot start the graph thread" << std::endl;
+    exit(2);
+  }
+}
+
+GraphScheduler::~GraphScheduler()
+{
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_signal(&changed);
+  pthread_mutex_unlock(&lock);
+  pthread_join(worker, NULL);
+
+  pthread_cond_destroy(&drained);
+  pthread_cond_destroy(&changed);
+  pthread_mutex_destroy(&lock);
+}
+
+void GraphScheduler::Notify(std::string activity, const AnalysisInfo& changed_skew)
+{
+  pthread_mutex_lock(&lock);
+  notified++;
+  auto found = hosts.find(changed_skew.Address);
+  if (activity == "inactive") {
+    if (found != hosts.end()) {
+      Entry &entry = found->second;
+      if (entry.dirty) {
+        // The last skew of the host is drawn without waiting for the interval
+        schedule.erase(entry.scheduled);
+        entry.scheduled = schedule.insert(std::make_pair(-INFINITY, found->first)).first;
+        entry.inactive = true;
+        pthread_cond_signal(&changed);
+      }
+      else {
+        hosts.erase(found);
+      }
+    }
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  // Nothing is drawn until the first skew is computed, saved computers
+  // notified by their name have no packets to be drawn
+  AddressKey key;
+  if (changed_skew.ClockSkewList.empty() || !AddressKey::Parse(changed_skew.Address, key)) {
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  if (found == hosts.end()) {
+    found = hosts.insert(std::make_pair(changed_skew.Address, Entry())).first;
+    // A new host is drawn at once
+    found->second.lastDrawn = -INFINITY;
+    found->second.dirty = false;
+  }
+  Entry &entry = found->second;
+  entry.inactive = false;
+  // Only the latest skew of the host is drawn
+  entry.similarIdentities = changed_skew.SimilarIdentities;
+  entry.clockSkewList = changed_skew.ClockSkewList;
+  if (!entry.dirty) {
+    double due = entry.lastDrawn + Configurator::instance()->graphInterval;
+    entry.scheduled = schedule.insert(std::make_pair(due, found->first)).first;
+    entry.dirty = true;
+    pthread_cond_signal(&changed);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void GraphScheduler::Flush()
+{
+  pthread_mutex_lock(&lock);
+  flushing = true;
+  pthread_cond_signal(&changed);
+  while (!schedule.empty() || busy) {
+    pthread_cond_wait(&drained, &lock);
+  }
+  flushing = false;
+  pthread_mutex_unlock(&lock);
+}
+
+void GraphScheduler::PrintStatistics()
+{
+  pthread_mutex_lock(&lock);
+  std::cerr << "Graph scheduler statistics: " << notified << " notifications, " <<
+    drawn << " graphs generated, " << schedule.size() << " hosts dirty" << std::endl;
+  pthread_mutex_unlock(&lock);
+}
+
+void GraphScheduler::update_viewed(double now)
+{
+  if (now - viewedChecked < VIEWED_CHECK_INTERVAL) {
+    return;
+  }
+  viewedChecked = now;
+
+  std::string filename = Configurator::xmlDir + "viewed";
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0) {
+    viewed.clear();
+    viewedModified = 0;
+    return;
+  }
+  if (info.st_mtime == viewedModified) {
+    return;
+  }
+  viewedModified = info.st_mtime;
+
+  viewed.clear();
+  std::ifstream ifs(filename.c_str());
+  std::string address;
+  while (std::getline(ifs, address)) {
+    if (!address.empty()) {
+      viewed.insert(address);
+    }
+  }
+}
+
+std::unordered_map<std::string, GraphScheduler::Entry>::iterator GraphScheduler::choose(double now, double &wait)
+{
+  // The web UI views only a few hosts, they go first if they are due
+  for (auto it = viewed.begin(); it != viewed.end(); ++it) {
+    auto found = hosts.find(*it);
+    if (found != hosts.end() && found->second.dirty &&
+        (flushing || found->second.scheduled->first <= now)) {
+      return found;
+    }
+  }
+
+  double due = schedule.begin()->first;
+  if (flushing || due <= now) {
+    return hosts.find(schedule.begin()->second);
+  }
+  wait = due - now;
+  return hosts.end();
+}
+
+void * GraphScheduler::WorkerThread(void *scheduler)
+{
+  GraphScheduler *self = static_cast<GraphScheduler *>(scheduler);
+  std::string address;
+  identity_container identities;
+  TimeSegmentList skew;
+
+  pthread_mutex_lock(&self->lock);
+  while (true) {
+    while (self->schedule.empty() && !self->stopping) {
+      pthread_cond_wait(&self->changed, &self->lock);
+    }
+    if (self->schedule.empty()) {
+      break;
+    }
+
+    double now = monotonic_time();
+    pthread_mutex_unlock(&self->lock);
+    self->update_viewed(now);
+    pthread_mutex_lock(&self->lock);
+    if (self->schedule.empty()) {
+      continue;
+    }
+
+    double wait = 0.0;
+    auto chosen = self->choose(now, wait);
+    if (chosen == self->hosts.end()) {
+      if (self->stopping) {
+        break;
+      }
+      // Sleep until the first host is due, a notification or a flush wakes us
+      double wake = now + wait;
+      struct timespec deadline;
+      deadline.tv_sec = static_cast<time_t>(wake);
+      deadline.tv_nsec = static_cast<long>((wake - deadline.tv_sec) * 1e9);
+      pthread_cond_timedwait(&self->changed, &self->lock, &deadline);
+      continue;
+    }
+
+    Entry &entry = chosen->second;
+    self->schedule.erase(entry.scheduled);
+    entry.dirty = false;
+    entry.lastDrawn = now;
+    address = chosen->first;
+    identities.swap(entry.similarIdentities);
+    std::swap(skew, entry.clockSkewList);
+    self->busy = true;
+    pthread_mutex_unlock(&self->lock);
+
+    AnalysisInfo info = {address, identities, skew};
+    self->target.Notify("active", info);
+
+    pthread_mutex_lock(&self->lock);
+    auto drawnHost = self->hosts.find(address);
+    if (drawnHost != self->hosts.end() && drawnHost->second.inactive && !drawnHost->second.dirty) {
+      self->hosts.erase(drawnHost);
+    }
+    self->busy = false;
+    self->drawn++;
+    if (self->schedule.empty()) {
+      pthread_cond_broadcast(&self->drained);
+    }
+  }
+  pthread_mutex_unlock(&self->lock);
+  return NULL;
+}
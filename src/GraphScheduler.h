@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GRAPH_SCHEDULER_H
+#define _GRAPH_SCHEDULER_H
+
+#include <ctime>
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "AnalysisInfo.h"
+#include "Observer.h"
+
+/**
+ * Coalesced and rate-limited regeneration of graphs. The scheduler stands in
+ * front of a graph observer, notifications only mark the host dirty (the
+ * latest skew of the host is kept) and a background thread passes dirty hosts
+ * to the graph observer, each host at most once per GRAPH_INTERVAL seconds.
+ *
+ * Hosts listed in the file written by the web UI (www/data/viewed, one
+ * address per line) are regenerated before other hosts.
+ *
+ * Inactive hosts are forgotten, a pending graph of an inactive host is drawn
+ * at once before the host is forgotten.
+ */
+class GraphScheduler: public Observer<const AnalysisInfo>
+{
+  // Private types
+  private:
+    struct Entry {
+      identity_container similarIdentities;
+      TimeSegmentList clockSkewList;
+      /// Position of the host in the schedule, valid only if dirty
+      std::set<std::pair<double, std::string> >::iterator scheduled;
+      /// Monotonic time of the last regeneration
+      double lastDrawn;
+      bool dirty;
+      /// The host is inactive, it is forgotten when its pending graph is drawn
+      bool inactive;
+    };
+
+  // Attributes
+  private:
+    Observer<const AnalysisInfo> &target;
+
+    pthread_mutex_t lock;
+    /// Signalled when a host becomes dirty or the scheduler is flushed
+    pthread_cond_t changed;
+    /// Signalled when the worker has nothing to do in the flush mode
+    pthread_cond_t drained;
+    pthread_t worker;
+
+    std::unordered_map<std::string, Entry> hosts;
+    /// Dirty hosts ordered by the time when they may be regenerated
+    std::set<std::pair<double, std::string> > schedule;
+    /// Hosts viewed in the web UI, used by the worker only
+    std::unordered_set<std::string> viewed;
+    time_t viewedModified;
+    double viewedChecked;
+
+    /// Regenerate all dirty hosts without waiting for the interval
+    bool flushing;
+    /// True while the worker regenerates a graph outside of the lock
+    bool busy;
+    bool stopping;
+
+    // Statistics
+    unsigned long notified;
+    unsigned long drawn;
+
+  // Constructors, destructors
+  public:
+    /**
+     * Constructor
+     * @param[in] graph Observer that generates graphs
+     */
+    GraphScheduler(Observer<const AnalysisInfo> &graph);
+    ~GraphScheduler();
+
+  private:
+    GraphScheduler(const GraphScheduler &);
+    GraphScheduler & operator=(const GraphScheduler &);
+
+  // Public methods
+  public:
+    virtual void Notify(std::string activity, const AnalysisInfo& changed_skew);
+
+    /// Regenerates all dirty hosts and waits until they are passed to the graph observer
+    void Flush();
+
+    /// Prints statistics of the scheduler to stderr
+    void PrintStatistics();
+
+  // Private methods
+  private:
+    static void * WorkerThread(void *scheduler);
+
+    /// Rereads the list of hosts viewed in the web UI if it has changed
+    void update_viewed(double now);
+
+    /**
+     * Chooses the next host to be regenerated, the lock is held
+     * @param[in] now Current monotonic time
+     * @param[out] wait Seconds until the first host may be regenerated if
+     * no host is due
+     * @return Iterator to the chosen host or hosts.end()
+     */
+    std::unordered_map<std::string, Entry>::iterator choose(double now, double &wait);
+};
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HostIndex.h"
+
+/// Initial number of slots, has to be a power of 2
+const size_t INITIAL_SLOTS = 64;
+
+HostIndex::HostIndex(): slots(INITIAL_SLOTS), count(0), mask(INITIAL_SLOTS - 1)
+{
+}
+
+void HostIndex::Insert(const AddressKey &key, ComputerInfo *computer)
+{
+  // Keep the load factor at most 1/2
+  if (2 * (count + 1) > slots.size()) {
+    Grow();
+  }
+  size_t i = key.Hash() & mask;
+  while (slots[i].computer != NULL) {
+    i = (i + 1) & mask;
+  }
+  slots[i].key = key;
+  slots[i].computer = computer;
+  count++;
+}
+
+bool HostIndex::Erase(const AddressKey &key)
+{
+  size_t i = key.Hash() & mask;
+  while (slots[i].computer != NULL && slots[i].key != key) {
+    i = (i + 1) & mask;
+  }
+  if (slots[i].computer == NULL) {
+    return false;
+  }
+
+  // Move back the entries of the cluster that cannot be found after the removal
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask; slots[j].computer != NULL; j = (j + 1) & mask) {
+    size_t home = slots[j].key.Hash() & mask;
+    // Entry j can fill the hole if its home slot is not in (hole, j]
+    if (((j - home) & mask) >= ((j - hole) & mask)) {
+      slots[hole] = slots[j];
+      hole = j;
+    }
+  }
+  slots[hole] = Slot();
+  count--;
+  return true;
+}
+
+void HostIndex::Grow()
+{
+  std::vector<Slot> old;
+  old.swap(slots);
+  slots.resize(2 * old.size());
+  mask = slots.size() - 1;
+  count = 0;
+  for (auto it = old.begin(); it != old.end(); ++it) {
+    if (it->computer != NULL) {
+      Insert(it->key, it->computer);
+    }
+  }
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOST_INDEX_H
+#define _HOST_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+#include "AddressKey.h"
+
+class ComputerInfo;
+
+/**
+ * Open addressing hash table (linear probing) mapping address keys to
+ * computers. Removal shifts the following entries back, so there are no
+ * tombstones and lookups never degrade after many insertions and removals.
+ */
+class HostIndex {
+  // Private types
+  private:
+    struct Slot {
+      AddressKey key;
+      /// NULL for an empty slot
+      ComputerInfo *computer;
+
+      Slot(): key(), computer(NULL) {}
+    };
+
+  // Attributes
+  private:
+    std::vector<Slot> slots;
+    /// Number of stored computers
+    size_t count;
+    /// slots.size() - 1, the size is a power of 2
+    size_t mask;
+
+  // Constructors
+  public:
+    HostIndex();
+
+  // Public methods
+  public:
+    /**
+     * Finds the computer with the given key
+     * @return Computer or NULL if the key is not indexed
+     */
+    ComputerInfo * Find(const AddressKey &key) const
+    {
+      for (size_t i = key.Hash() & mask; slots[i].computer != NULL; i = (i + 1) & mask) {
+        if (slots[i].key == key) {
+          return slots[i].computer;
+        }
+      }
+      return NULL;
+    }
+
+    /**
+     * Adds a computer to the index, the key must not be indexed yet
+     */
+    void Insert(const AddressKey &key, ComputerInfo *computer);
+
+    /**
+     * Removes the computer with the given key from the index
+     * @return true if the key was indexed
+     */
+    bool Erase(const AddressKey &key);
+
+    size_t Size() const
+    {
+      return count;
+    }
+
+  // Private methods
+  private:
+    /// Doubles the table and reinserts all computers
+    void Grow();
+};
+
+#endif
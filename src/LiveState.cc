@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ComputerInfo.h"
+#include "LiveState.h"
+
+LiveState * LiveState::instance()
+{
+  // The initialization of a local static is thread safe, the state is never
+  // destroyed (it is closed at exit)
+  static LiveState *innerInstance = new LiveState();
+  return innerInstance;
+}
+
+LiveState::LiveState(): name(), header(NULL), hosts(NULL), size(0), unused(), dropped(0)
+{
+  pthread_mutex_init(&lock, NULL);
+}
+
+int LiveState::Open(const std::string &objectName, unsigned int capacity)
+{
+  int fd = shm_open(objectName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "Cannot create shared memory " << objectName << ": " << strerror(errno) << std::endl;
+    return 2;
+  }
+  size_t length = sizeof(struct pcf_state_header) + (size_t) capacity * sizeof(struct pcf_state_host);
+  if (ftruncate(fd, length) != 0) {
+    std::cerr << "Cannot resize shared memory " << objectName << ": " << strerror(errno) << std::endl;
+    close(fd);
+    shm_unlink(objectName.c_str());
+    return 2;
+  }
+  void *mapped = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    std::cerr << "Cannot map shared memory " << objectName << ": " << strerror(errno) << std::endl;
+    shm_unlink(objectName.c_str());
+    return 2;
+  }
+
+  // The object is zeroed by ftruncate, all slots are free
+  name = objectName;
+  size = length;
+  header = (struct pcf_state_header *) mapped;
+  hosts = (struct pcf_state_host *) (header + 1);
+  header->version = PCF_STATE_VERSION;
+  header->hostSize = sizeof(struct pcf_state_host);
+  header->capacity = capacity;
+  header->pid = getpid();
+  // Readers recognize a complete header by the magic
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(header->magic, PCF_STATE_MAGIC, sizeof(header->magic));
+  return 0;
+}
+
+void LiveState::Close()
+{
+  if (header == NULL) {
+    return;
+  }
+  munmap(header, size);
+  shm_unlink(name.c_str());
+  header = NULL;
+  hosts = NULL;
+  size = 0;
+}
+
+void LiveState::begin_write(uint32_t &sequence)
+{
+  uint32_t value = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&sequence, value + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void LiveState::end_write(uint32_t &sequence)
+{
+  uint32_t value = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&sequence, value + 1, __ATOMIC_RELEASE);
+}
+
+void LiveState::Publish(ComputerInfo &computer, const std::string &type, int cluster)
+{
+  if (hosts == NULL) {
+    return;
+  }
+
+  if (computer.stateSlot < 0) {
+    pthread_mutex_lock(&lock);
+    if (!unused.empty()) {
+      computer.stateSlot = unused.back();
+      unused.pop_back();
+    }
+    else if (header->used < header->capacity) {
+      computer.stateSlot = header->used;
+      __atomic_store_n(&header->used, header->used + 1, __ATOMIC_RELEASE);
+    }
+    else {
+      dropped++;
+    }
+    pthread_mutex_unlock(&lock);
+    if (computer.stateSlot < 0) {
+      return;
+    }
+  }
+
+  write_counters(computer);
+
+  struct pcf_state_host &host = hosts[computer.stateSlot];
+  begin_write(host.sequence);
+  host.active = 1;
+  strncpy(host.type, type.c_str(), PCF_STATE_TYPE - 1);
+  strncpy(host.address, computer.get_address().c_str(), PCF_STATE_ADDRESS - 1);
+  host.cluster = cluster;
+
+  // The newest segments are kept
+  const TimeSegmentList &skew = computer.timeSegmentList;
+  size_t segments = skew.cend() - skew.cbegin();
+  size_t kept = std::min<size_t>(segments, PCF_STATE_SEGMENTS);
+  TimeSegmentList::const_iterator it = skew.cend() - kept;
+  for (size_t i = 0; i < kept; i++, ++it) {
+    host.segment[i].alpha = it->alpha;
+    host.segment[i].startTime = it->startTime;
+    host.segment[i].endTime = it->endTime;
+  }
+  host.segments = segments;
+  end_write(host.sequence);
+}
+
+void LiveState::PublishCluster(ComputerInfo &computer, int cluster)
+{
+  if (hosts == NULL || computer.stateSlot < 0) {
+    return;
+  }
+
+  struct pcf_state_host &host = hosts[computer.stateSlot];
+  begin_write(host.sequence);
+  host.cluster = cluster;
+  end_write(host.sequence);
+}
+
+void LiveState::PublishCounters(ComputerInfo &computer)
+{
+  if (hosts == NULL || computer.stateSlot < 0) {
+    return;
+  }
+  write_counters(computer);
+}
+
+void LiveState::write_counters(ComputerInfo &computer)
+{
+  struct pcf_state_host &host = hosts[computer.stateSlot];
+  begin_write(host.countersSequence);
+  host.frequency = computer.get_freq();
+  host.packets = computer.get_packets_count();
+  host.lastPacketTime = computer.get_last_packet_time();
+  end_write(host.countersSequence);
+}
+
+void LiveState::Remove(ComputerInfo &computer)
+{
+  if (hosts == NULL || computer.stateSlot < 0) {
+    return;
+  }
+
+  struct pcf_state_host &host = hosts[computer.stateSlot];
+  begin_write(host.sequence);
+  host.active = 0;
+  end_write(host.sequence);
+
+  pthread_mutex_lock(&lock);
+  unused.push_back(computer.stateSlot);
+  pthread_mutex_unlock(&lock);
+  computer.stateSlot = -1;
+}
+
+void LiveState::PrintStatistics()
+{
+  if (hosts == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&lock);
+  std::cerr << "Shared state " << name << ": " << header->used - unused.size() << " of " <<
+    header->capacity << " slots used, " << dropped << " computers without a slot" << std::endl;
+  pthread_mutex_unlock(&lock);
+}
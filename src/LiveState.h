@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LIVE_STATE_H
+#define _LIVE_STATE_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "pcf_state.h"
+
+class ComputerInfo;
+
+/**
+ * Writer of the live state of active computers in shared memory (see
+ * pcf_state.h). A computer gets a slot when its clock skew is published for
+ * the first time and releases it when it becomes inactive.
+ *
+ * Only the thread that processes packets of a computer (its owner) assigns,
+ * publishes and releases its slot and writes its counters, the counters are
+ * written without any lock with every packet. The skew part of a slot is
+ * written under the lock of the group, so other threads may change the
+ * cluster of a computer. Slots are assigned under the lock of the state.
+ */
+class LiveState {
+  // Attributes
+  private:
+    pthread_mutex_t lock;
+    std::string name;
+    struct pcf_state_header *header;
+    struct pcf_state_host *hosts;
+    size_t size;
+    /// Released slots
+    std::vector<uint32_t> unused;
+    /// Computers that did not get a slot
+    unsigned long dropped;
+
+  // Constructors, destructors
+  private:
+    LiveState();
+
+    LiveState(const LiveState &);
+    LiveState & operator=(const LiveState &);
+
+  public:
+    static LiveState * instance();
+
+  // Public methods
+  public:
+    /**
+     * Creates the shared memory object
+     * @param[in] objectName Name of the object (e.g. "/pcf")
+     * @param[in] capacity Number of slots
+     * @return 0 if ok, 2 otherwise
+     */
+    int Open(const std::string &objectName, unsigned int capacity);
+
+    /// Removes the shared memory object, readers keep their mapping
+    void Close();
+
+    bool Enabled() const
+    {
+      return hosts != NULL;
+    }
+
+    /**
+     * Writes the current state of a computer into its slot, called by the
+     * owner of the computer under the group lock
+     * @param[in] computer Computer to be published
+     * @param[in] type Type of the computer list (tcp, javascript, icmp)
+     * @param[in] cluster Cluster of the computer or -1
+     */
+    void Publish(ComputerInfo &computer, const std::string &type, int cluster);
+
+    /**
+     * Writes the cluster of a computer of any shard into its slot, called
+     * under the group lock, a computer without a slot is skipped
+     */
+    void PublishCluster(ComputerInfo &computer, int cluster);
+
+    /// Writes the counters of a computer into its slot, called by its owner
+    void PublishCounters(ComputerInfo &computer);
+
+    /// Releases the slot of an inactive computer
+    void Remove(ComputerInfo &computer);
+
+    /// Prints statistics of the state to stderr
+    void PrintStatistics();
+
+  // Private methods
+  private:
+    /// Makes a sequence of a slot odd, its part of the slot may be changed
+    static void begin_write(uint32_t &sequence);
+
+    /// Makes a sequence of a slot even, its part of the slot is consistent
+    static void end_write(uint32_t &sequence);
+
+    void write_counters(ComputerInfo &computer);
+};
+
+#endif
@@ -0,0 +1,248 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "Configurator.h"
+#include "OutputQueue.h"
+#include "PacketLog.h"
+
+OutputQueue * OutputQueue::instance()
+{
+  // The first call may come from any thread, the initialization of a local
+  // static is thread safe. The queue is never destroyed, its writer runs
+  // until the program exits.
+  static OutputQueue *innerInstance = new OutputQueue();
+  return innerInstance;
+}
+
+OutputQueue::OutputQueue():
+  jobs(), pending(), queuedBytes(0), busy(false), gnuplot(),
+  written(0), coalesced(0), dropped(0), waited(0), maxDepth(0), maxBytes(0)
+{
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&queued, NULL);
+  pthread_cond_init(&drained, NULL);
+  pthread_cond_init(&space, NULL);
+  if (pthread_create(&writer, NULL, WriterThread, this) != 0) {
+    std::cerr << "Cannot start the output thread" << std::endl;
+    exit(2);
+  }
+}
+
+void OutputQueue::Replace(const std::string &filename, const std::string &content)
+{
+  Job job = {filename, content, false, false, "", ""};
+  Submit(job, false);
+}
+
+void OutputQueue::Plot(const std::string &script, const std::string &content,
+    const std::string &samples, const std::string &data)
+{
+  Job job = {script, content, false, true, samples, data};
+  Submit(job, true);
+}
+
+void OutputQueue::Append(const std::string &filename, const std::string &data)
+{
+  if (data.empty()) {
+    return;
+  }
+  Job job = {filename, data, true, false, "", ""};
+  Submit(job, false);
+}
+
+void OutputQueue::Submit(Job &job, bool droppable)
+{
+  pthread_mutex_lock(&lock);
+  size_t limit = Configurator::instance()->outputQueueLimit;
+  if (!droppable && queuedBytes > 0 && queuedBytes + job.data.size() > limit) {
+    // Data that is never dropped waits for the disk, an empty queue accepts
+    // a job of any size
+    waited++;
+    do {
+      pthread_cond_wait(&space, &lock);
+    } while (queuedBytes > 0 && queuedBytes + job.data.size() > limit);
+  }
+
+  auto found = pending.find(job.filename);
+  if (found != pending.end()) {
+    Job &queued_job = *(found->second);
+    queuedBytes -= queued_job.data.size();
+    if (job.append) {
+      queued_job.data += job.data;
+    }
+    else {
+      // The older content would be overwritten anyway
+      queued_job.data.swap(job.data);
+      queued_job.append = false;
+      queued_job.plot = job.plot;
+      queued_job.samples.swap(job.samples);
+      queued_job.samplesData.swap(job.samplesData);
+    }
+    queuedBytes += queued_job.data.size();
+    coalesced++;
+  }
+  else if (droppable && queuedBytes + job.data.size() > limit) {
+    dropped++;
+  }
+  else {
+    queuedBytes += job.data.size();
+    jobs.push_back(Job());
+    jobs.back().filename.swap(job.filename);
+    jobs.back().data.swap(job.data);
+    jobs.back().append = job.append;
+    jobs.back().plot = job.plot;
+    jobs.back().samples.swap(job.samples);
+    jobs.back().samplesData.swap(job.samplesData);
+    pending[jobs.back().filename] = std::prev(jobs.end());
+    pthread_cond_signal(&queued);
+  }
+
+  if (jobs.size() > maxDepth) {
+    maxDepth = jobs.size();
+  }
+  if (queuedBytes > maxBytes) {
+    maxBytes = queuedBytes;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void OutputQueue::Flush()
+{
+  pthread_mutex_lock(&lock);
+  while (!jobs.empty() || busy) {
+    pthread_cond_wait(&drained, &lock);
+  }
+  // The writer is idle and cannot take another job while the lock is held,
+  // gnuplot is started again by the next graph
+  gnuplot.Stop();
+  pthread_mutex_unlock(&lock);
+}
+
+size_t OutputQueue::Depth()
+{
+  pthread_mutex_lock(&lock);
+  size_t depth = jobs.size();
+  pthread_mutex_unlock(&lock);
+  return depth;
+}
+
+void OutputQueue::PrintStatistics()
+{
+  pthread_mutex_lock(&lock);
+  std::cerr << "Output queue statistics: " << written << " files written, " <<
+    coalesced << " coalesced, " << dropped << " dropped, " << waited <<
+    " waited for the disk, maximal depth " <<
+    maxDepth << " files (" << maxBytes << " B), gnuplot started " <<
+    gnuplot.get_starts() << " times" << std::endl;
+  pthread_mutex_unlock(&lock);
+}
+
+void * OutputQueue::WriterThread(void *queue)
+{
+  OutputQueue *self = static_cast<OutputQueue *>(queue);
+  Job job;
+
+  pthread_mutex_lock(&self->lock);
+  while (true) {
+    while (self->jobs.empty()) {
+      pthread_cond_wait(&self->queued, &self->lock);
+    }
+    job = Job();
+    Job &front = self->jobs.front();
+    job.filename.swap(front.filename);
+    job.data.swap(front.data);
+    job.append = front.append;
+    job.plot = front.plot;
+    job.samples.swap(front.samples);
+    job.samplesData.swap(front.samplesData);
+    self->pending.erase(job.filename);
+    self->jobs.pop_front();
+    self->queuedBytes -= job.data.size();
+    self->busy = true;
+    pthread_cond_broadcast(&self->space);
+    pthread_mutex_unlock(&self->lock);
+
+    self->Write(job);
+
+    pthread_mutex_lock(&self->lock);
+    self->busy = false;
+    self->written++;
+    if (self->jobs.empty()) {
+      pthread_cond_broadcast(&self->drained);
+    }
+  }
+  return NULL;
+}
+
+void OutputQueue::Write(const Job &job)
+{
+  // A replaced file is never seen half written
+  std::string target = job.append ? job.filename : job.filename + ".tmp";
+  FILE *f = fopen(target.c_str(), job.append ? "ab" : "wb");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open file: %s\n", target.c_str());
+    return;
+  }
+  bool ok = job.data.empty() || fwrite(job.data.data(), job.data.size(), 1, f) == 1;
+  if (fclose(f) != 0 || !ok) {
+    fprintf(stderr, "Cannot write file: %s\n", target.c_str());
+    return;
+  }
+  if (!job.append && rename(target.c_str(), job.filename.c_str()) != 0) {
+    fprintf(stderr, "File could not be replaced by temporary file: %s\n", job.filename.c_str());
+    return;
+  }
+
+  if (job.plot && WriteSamples(job)) {
+    gnuplot.Plot(job.filename);
+  }
+}
+
+bool OutputQueue::WriteSamples(const Job &job)
+{
+  if (job.samples.empty()) {
+    return true;
+  }
+  // Gnuplot may be still reading the data file of the previous graph
+  std::string target = job.samplesData + ".tmp";
+  std::ofstream out(target.c_str());
+  if (!out) {
+    fprintf(stderr, "Cannot open file: %s\n", target.c_str());
+    return false;
+  }
+  if (PacketLog::PrintText(job.samples, out) != 0) {
+    fprintf(stderr, "Cannot read packet log: %s\n", job.samples.c_str());
+    return false;
+  }
+  out.close();
+  if (!out) {
+    fprintf(stderr, "Cannot write file: %s\n", target.c_str());
+    return false;
+  }
+  if (rename(target.c_str(), job.samplesData.c_str()) != 0) {
+    fprintf(stderr, "File could not be replaced by temporary file: %s\n", job.samplesData.c_str());
+    return false;
+  }
+  return true;
+}
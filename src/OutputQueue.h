@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OUTPUT_QUEUE_H
+#define _OUTPUT_QUEUE_H
+
+#include <list>
+#include <pthread.h>
+#include <string>
+#include <unordered_map>
+
+#include "GnuplotProcess.h"
+
+/**
+ * Write-behind output of files. Packet processing only queues the content
+ * of files, a writer thread writes them to the disk, so the capture does not
+ * wait for the filesystem.
+ *
+ * Each file has at most one pending job: appends to a file are merged, a new
+ * content of a file replaces its older pending content (a stale snapshot is
+ * never written). When the queue holds more than OUTPUT_QUEUE_LIMIT bytes,
+ * new droppable snapshots (graphs) are dropped. Appended data and other
+ * snapshots are never dropped, their producer waits until the writer makes
+ * room in the queue instead.
+ */
+class OutputQueue {
+  // Private types
+  private:
+    struct Job {
+      std::string filename;
+      std::string data;
+      /// Append data to the file, the file is replaced otherwise
+      bool append;
+      /// The file is a gnuplot script to be plotted after it is written
+      bool plot;
+      /// Packet log of a plotted script and the text data file read by the
+      /// script, the log is converted before the script is plotted
+      std::string samples;
+      std::string samplesData;
+    };
+
+  // Attributes
+  private:
+    pthread_mutex_t lock;
+    /// Signalled when a job is queued
+    pthread_cond_t queued;
+    /// Signalled when the queue is drained
+    pthread_cond_t drained;
+    /// Signalled when the writer takes a job from the queue
+    pthread_cond_t space;
+    pthread_t writer;
+
+    std::list<Job> jobs;
+    /// Pending job of each file
+    std::unordered_map<std::string, std::list<Job>::iterator> pending;
+    /// Bytes of data in the queue
+    size_t queuedBytes;
+    /// True while the writer processes a job outside of the queue
+    bool busy;
+
+    /// Plots graphs, used by the writer thread only
+    GnuplotProcess gnuplot;
+
+    // Statistics
+    unsigned long written;
+    unsigned long coalesced;
+    unsigned long dropped;
+    /// Jobs whose producer waited for room in the queue
+    unsigned long waited;
+    size_t maxDepth;
+    size_t maxBytes;
+
+  // Constructors, destructors
+  private:
+    OutputQueue();
+    OutputQueue(const OutputQueue &);
+    OutputQueue & operator=(const OutputQueue &);
+
+  public:
+    static OutputQueue * instance();
+
+  // Public methods
+  public:
+    /**
+     * Replaces the content of a file, the file is written to a temporary file
+     * first and renamed
+     * @param[in] filename File to be replaced
+     * @param[in] content New content of the file
+     */
+    void Replace(const std::string &filename, const std::string &content);
+
+    /**
+     * Replaces a gnuplot script and plots it, the graph may be dropped if the
+     * queue is full. Packets of the last tracking in the packet log are
+     * written to the data file as text first, so gnuplot starts no process.
+     * @param[in] script Filename of the script
+     * @param[in] content Content of the script
+     * @param[in] samples Packet log (log/<type>/<address>.plog)
+     * @param[in] data Text data file read by the script
+     */
+    void Plot(const std::string &script, const std::string &content,
+        const std::string &samples, const std::string &data);
+
+    /**
+     * Appends data to a file
+     * @param[in] filename File to be appended
+     * @param[in] data Data to be appended
+     */
+    void Append(const std::string &filename, const std::string &data);
+
+    /// Waits until all queued files are written and all graphs are plotted
+    void Flush();
+
+    /// Number of queued jobs
+    size_t Depth();
+
+    /// Prints statistics of the queue to stderr
+    void PrintStatistics();
+
+  // Private methods
+  private:
+    /// Queues a job or merges it with the pending job of the same file
+    void Submit(Job &job, bool droppable);
+
+    static void * WriterThread(void *queue);
+
+    /// Performs a job, the lock is not held
+    void Write(const Job &job);
+    /// Converts the packet log of a plotted script to its data file
+    bool WriteSamples(const Job &job);
+};
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+#include "Computations.h"
+#include "PacketLog.h"
+#include "PacketTimeInfo.h"
+
+const char PacketLog::MAGIC[8] = {'P', 'C', 'F', 'P', 'L', 'O', 'G', '1'};
+
+template <typename T>
+static void put(std::string &buffer, T value)
+{
+  buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool get(FILE *f, T &value)
+{
+  return fread(&value, sizeof(value), 1, f) == 1;
+}
+
+void PacketLog::AddHeader(std::string &buffer)
+{
+  buffer.append(MAGIC, sizeof(MAGIC));
+}
+
+void PacketLog::AddStart(std::string &buffer, double start_time, int freq)
+{
+  buffer.push_back(START);
+  put<double>(buffer, start_time);
+  put<int32_t>(buffer, freq);
+}
+
+void PacketLog::AddFrequency(std::string &buffer, int freq)
+{
+  buffer.push_back(FREQUENCY);
+  put<int32_t>(buffer, freq);
+}
+
+void PacketLog::AddSample(std::string &buffer, double arrival_time, uint64_t timestamp)
+{
+  buffer.push_back(SAMPLE);
+  put<double>(buffer, arrival_time);
+  put<uint64_t>(buffer, timestamp);
+}
+
+FILE * PacketLog::Open(const std::string &filename)
+{
+  FILE *f = fopen(filename.c_str(), "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  char magic[sizeof(MAGIC)];
+  if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+    fclose(f);
+    return NULL;
+  }
+  return f;
+}
+
+bool PacketLog::Read(FILE *f, Record &record)
+{
+  int type = fgetc(f);
+  switch (type) {
+    case START:
+      record.type = START;
+      return get(f, record.time) && get(f, record.freq);
+    case FREQUENCY:
+      record.type = FREQUENCY;
+      return get(f, record.freq);
+    case SAMPLE:
+      record.type = SAMPLE;
+      return get(f, record.time) && get(f, record.timestamp);
+    default:
+      // End of the file or a truncated log
+      return false;
+  }
+}
+
+int PacketLog::PrintText(const std::string &filename, std::ostream &out)
+{
+  FILE *f = Open(filename);
+  if (f == NULL) {
+    return 2;
+  }
+
+  // Offsets are known only when the frequency of the whole tracking is read
+  std::vector<PacketTimeInfo> packets;
+  int freq = 0;
+  Record record;
+  while (Read(f, record)) {
+    if (record.type == START) {
+      packets.clear();
+      freq = record.freq;
+    }
+    else if (record.type == FREQUENCY) {
+      freq = record.freq;
+    }
+    else {
+      PacketTimeInfo packet;
+      packet.ArrivalTime = record.time;
+      packet.Timestamp = record.timestamp;
+      packet.Offset.x = 0.0;
+      packet.Offset.y = 0.0;
+      packets.push_back(packet);
+    }
+  }
+  fclose(f);
+
+  out << std::setprecision(6) << std::fixed;
+  for (auto it = packets.begin(); it != packets.end(); ++it) {
+    if (freq != 0) {
+      Computations::SetOffset(*it, packets.front(), freq);
+    }
+    out << it->Offset.x << "\t" << it->Offset.y << "\t" << it->ArrivalTime <<
+      "\t" << it->Timestamp << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PACKET_LOG_H
+#define _PACKET_LOG_H
+
+#include <cstdio>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+
+/**
+ * Binary append-only log of packets of one computer (log/<type>/<address>.plog).
+ *
+ * The file starts with the 8 byte magic "PCFPLOG1" followed by records, each
+ * record is a type byte and fields in the host byte order:
+ *  - START     (double start time, int32 frequency): a new tracking starts,
+ *              the next sample is its first packet
+ *  - FREQUENCY (int32 frequency): frequency of the tracking was found
+ *  - SAMPLE    (double arrival time, uint64 timestamp): a packet
+ *
+ * Offsets are not stored, they are computed from the first packet of the
+ * tracking and its frequency when the log is read.
+ */
+class PacketLog {
+  public:
+    enum RecordType {
+      START = 1,
+      FREQUENCY = 2,
+      SAMPLE = 3
+    };
+
+    /// Decoded record, only fields of its type are valid
+    struct Record {
+      RecordType type;
+      double time;
+      uint64_t timestamp;
+      int32_t freq;
+    };
+
+    static const char MAGIC[8];
+
+  // Encoding (records are collected in a buffer and appended to the file later)
+  public:
+    /// Adds the magic, it has to be at the beginning of the file
+    static void AddHeader(std::string &buffer);
+    static void AddStart(std::string &buffer, double start_time, int freq);
+    static void AddFrequency(std::string &buffer, int freq);
+    static void AddSample(std::string &buffer, double arrival_time, uint64_t timestamp);
+
+  // Decoding
+  public:
+    /**
+     * Opens a log for reading
+     * @return File positioned after the magic, NULL if the file is not a packet log
+     */
+    static FILE * Open(const std::string &filename);
+
+    /// Reads the next record, returns false at the end of the file
+    static bool Read(FILE *f, Record &record);
+
+    /**
+     * Prints packets of the last tracking in the text format of the former
+     * logs: offset x, offset y, arrival time and timestamp separated by tabs
+     * @return 0 if ok, 2 if the file cannot be read
+     */
+    static int PrintText(const std::string &filename, std::ostream &out);
+};
+
+#endif
@@ -20,7 +20,67 @@
 
 #ifndef PACKETSEGMENT_H
 #define	PACKETSEGMENT_H
+#include <vector>
+
 #include "PacketTimeInfo.h"
+#include "Point.h"
+
+/**
+ * Sums of offsets of a range of packets, the sum of distances of all points
+ * to the line y = alpha * x + beta is alpha * x + beta * count - y
+ */
+class OffsetSums {
+  public:
+    double x;
+    double y;
+    unsigned long count;
+
+    OffsetSums(): x(0.0), y(0.0), count(0) {}
+
+    void add(const Point &offset)
+    {
+      x += offset.x;
+      y += offset.y;
+      count++;
+    }
+
+    OffsetSums operator+(const Point &offset) const
+    {
+      OffsetSums result = *this;
+      result.add(offset);
+      return result;
+    }
+
+    OffsetSums & operator+=(const OffsetSums &other)
+    {
+      x += other.x;
+      y += other.y;
+      count += other.count;
+      return *this;
+    }
+
+    OffsetSums operator+(const OffsetSums &other) const
+    {
+      OffsetSums result = *this;
+      result += other;
+      return result;
+    }
+
+    OffsetSums operator-(const OffsetSums &other) const
+    {
+      OffsetSums result;
+      result.x = x - other.x;
+      result.y = y - other.y;
+      result.count = count - other.count;
+      return result;
+    }
+
+    /// Sum of distances of the points to the line
+    double distance(double alpha, double beta) const
+    {
+      return alpha * x + beta * count - y;
+    }
+};
 
 class PacketSegment {
     /// Structure describing clock skew
@@ -29,9 +89,17 @@ public:
       double beta;
       double confirmedAlpha;
       double confirmedBeta;
-      packet_iterator first;
-      packet_iterator confirmed;
-      packet_iterator last;
+      packet_index first;
+      packet_index confirmed;
+      packet_index last;
+      /// Offsets of packets [first, end of packets)
+      OffsetSums sums;
+      /// Upper convex hull of offsets of packets [first, end of packets)
+      std::vector<Point> hull;
+      /// Offsets of packets [first, confirmed)
+      OffsetSums confirmedSums;
+      /// Offsets of packets [first, last)
+      OffsetSums lastSums;
 };
 
 
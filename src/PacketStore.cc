@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "PacketStore.h"
+
+PacketStore::~PacketStore()
+{
+  clear();
+}
+
+void PacketStore::truncate(size_t new_size)
+{
+  if (new_size >= count) {
+    return;
+  }
+  count = new_size;
+  size_t needed_chunks = (count + CHUNK_MASK) >> CHUNK_BITS;
+  if (chunks.size() > needed_chunks) {
+    while (chunks.size() > needed_chunks) {
+      delete [] chunks.back();
+      chunks.pop_back();
+    }
+    // All chunks except the last one are full sized
+    lastChunkSize = chunks.empty() ? 0 : CHUNK_SIZE;
+  }
+}
+
+void PacketStore::shrink_to_fit()
+{
+  size_t used = count & CHUNK_MASK;
+  if (chunks.empty() || used == 0) {
+    return;
+  }
+  size_t new_size = INITIAL_CHUNK_SIZE;
+  while (new_size < used) {
+    new_size *= 2;
+  }
+  if (new_size < lastChunkSize) {
+    resize_last_chunk(new_size);
+  }
+}
+
+void PacketStore::grow()
+{
+  if ((count >> CHUNK_BITS) == chunks.size()) {
+    // The last chunk is full (or there is none)
+    chunks.push_back(new PacketTimeInfo[INITIAL_CHUNK_SIZE]);
+    lastChunkSize = INITIAL_CHUNK_SIZE;
+  }
+  else {
+    size_t new_size = 2 * lastChunkSize;
+    resize_last_chunk(new_size < CHUNK_SIZE ? new_size : CHUNK_SIZE);
+  }
+}
+
+void PacketStore::resize_last_chunk(size_t new_size)
+{
+  size_t used = count & CHUNK_MASK;
+  PacketTimeInfo *chunk = new PacketTimeInfo[new_size];
+  std::copy(chunks.back(), chunks.back() + used, chunk);
+  delete [] chunks.back();
+  chunks.back() = chunk;
+  lastChunkSize = new_size;
+}
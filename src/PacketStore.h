@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PACKET_STORE_H
+#define _PACKET_STORE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "PacketTimeInfo.h"
+
+/**
+ * Append-only store of packets of one computer. Packets are kept in fixed
+ * size contiguous chunks, so appending never moves other than the last chunk
+ * and indices of packets are stable until the store is truncated. The last
+ * chunk grows by doubling so that computers with a few packets stay small.
+ */
+class PacketStore {
+  // Constants
+  private:
+    static const size_t CHUNK_BITS = 10;
+    static const size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+    static const size_t CHUNK_MASK = CHUNK_SIZE - 1;
+    static const size_t INITIAL_CHUNK_SIZE = 16;
+
+  // Attributes
+  private:
+    std::vector<PacketTimeInfo *> chunks;
+    /// Number of stored packets
+    size_t count;
+    /// Number of packets that fit into the last chunk
+    size_t lastChunkSize;
+
+  // Constructors, destructors
+  public:
+    PacketStore(): chunks(), count(0), lastChunkSize(0) {}
+
+    ~PacketStore();
+
+  private:
+    // The store owns its chunks
+    PacketStore(const PacketStore &);
+    PacketStore & operator=(const PacketStore &);
+
+  // Public methods
+  public:
+    size_t size() const
+    {
+      return count;
+    }
+
+    bool empty() const
+    {
+      return count == 0;
+    }
+
+    PacketTimeInfo & operator[](packet_index i)
+    {
+      return chunks[i >> CHUNK_BITS][i & CHUNK_MASK];
+    }
+
+    const PacketTimeInfo & operator[](packet_index i) const
+    {
+      return chunks[i >> CHUNK_BITS][i & CHUNK_MASK];
+    }
+
+    PacketTimeInfo & front()
+    {
+      return chunks[0][0];
+    }
+
+    const PacketTimeInfo & front() const
+    {
+      return chunks[0][0];
+    }
+
+    PacketTimeInfo & back()
+    {
+      return (*this)[count - 1];
+    }
+
+    const PacketTimeInfo & back() const
+    {
+      return (*this)[count - 1];
+    }
+
+    /// Appends a packet
+    void push_back(const PacketTimeInfo &packet)
+    {
+      if ((count >> CHUNK_BITS) == chunks.size() || (count & CHUNK_MASK) == lastChunkSize) {
+        grow();
+      }
+      chunks[count >> CHUNK_BITS][count & CHUNK_MASK] = packet;
+      count++;
+    }
+
+    /**
+     * Removes packets from the end of the store and frees unused chunks
+     * @param[in] new_size Number of packets that are kept
+     */
+    void truncate(size_t new_size);
+
+    /// Removes all packets
+    void clear()
+    {
+      truncate(0);
+    }
+
+    /// Reallocates the last chunk so that it is not much larger than needed
+    void shrink_to_fit();
+
+    /// Returns the number of bytes allocated for packets
+    size_t memory_usage() const
+    {
+      if (chunks.empty()) {
+        return 0;
+      }
+      return ((chunks.size() - 1) * CHUNK_SIZE + lastChunkSize) * sizeof(PacketTimeInfo);
+    }
+
+  // Private methods
+  private:
+    /// Adds a new chunk or enlarges the last one
+    void grow();
+    /// Moves packets of the last chunk to a new chunk of the given size
+    void resize_last_chunk(size_t new_size);
+};
+
+#endif
@@ -21,7 +21,7 @@
 #ifndef _PACKET_TIME_INFO_H
 #define _PACKET_TIME_INFO_H
 
-#include <list>
+#include <cstddef>
 #include <stdint.h>
 
 #include "Point.h"
@@ -37,7 +37,7 @@ class PacketTimeInfo {
     Point Offset;
 };
 
-typedef std::list<PacketTimeInfo> packetTimeInfoList;
-typedef packetTimeInfoList::iterator packet_iterator;
+/// Position of a packet in the PacketStore of a computer
+typedef size_t packet_index;
 
 #endif
@@ -0,0 +1,375 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_arp.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#include "RingCapture.h"
+
+/// Time after which the kernel retires a block that is not full (ms)
+#define BLOCK_TIMEOUT 64
+/// Poll timeout (ms), the loop checks breakLoop at least this often
+#define POLL_TIMEOUT 1000
+
+RingCapture::~RingCapture() {
+  Close();
+}
+
+int RingCapture::Open(const char *dev, unsigned int blockSize, unsigned int blockCount, unsigned int frameSize) {
+  if (frameSize == 0 || blockSize < frameSize || (blockSize % getpagesize()) != 0 || blockCount == 0) {
+    std::cerr << "Wrong ring geometry: block " << blockSize << " B, frame " << frameSize <<
+      " B, " << blockCount << " blocks" << std::endl;
+    return (2);
+  }
+
+  if (strcmp(dev, "") == 0 || strcmp(dev, "any") == 0) {
+    // Frames of all devices may have different link layer headers
+    std::cerr << "Ring capture needs a device, it cannot capture on all devices" << std::endl;
+    return (2);
+  }
+
+  // The socket receives no frames until it is bound
+  fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (fd < 0) {
+    perror("socket() error");
+    return (2);
+  }
+
+  datalink = DeviceDatalink(dev);
+  if (datalink < 0) {
+    return (2);
+  }
+
+  int version = TPACKET_V3;
+  if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+    perror("setsockopt() for PACKET_VERSION error");
+    return (2);
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = blockSize;
+  req.tp_block_nr = blockCount;
+  req.tp_frame_size = frameSize;
+  req.tp_frame_nr = (blockSize / frameSize) * blockCount;
+  req.tp_retire_blk_tov = BLOCK_TIMEOUT;
+  req.tp_feature_req_word = 0;
+  if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    perror("setsockopt() for PACKET_RX_RING error");
+    return (2);
+  }
+
+  void *mapped = mmap(NULL, (size_t) blockSize * blockCount, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_LOCKED, fd, 0);
+  if (mapped == MAP_FAILED) {
+    perror("mmap() of the ring error");
+    return (2);
+  }
+  ring = static_cast<uint8_t *>(mapped);
+  currentBlock = 0;
+
+  // Bind to the device
+  struct sockaddr_ll ll;
+  memset(&ll, 0, sizeof(ll));
+  ll.sll_family = AF_PACKET;
+  ll.sll_protocol = htons(ETH_P_ALL);
+  ll.sll_ifindex = if_nametoindex(dev);
+  if (ll.sll_ifindex == 0) {
+    std::cerr << "Couldn't find device " << dev << std::endl;
+    return (2);
+  }
+  struct packet_mreq mreq;
+  memset(&mreq, 0, sizeof(mreq));
+  mreq.mr_ifindex = ll.sll_ifindex;
+  mreq.mr_type = PACKET_MR_PROMISC;
+  if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    perror("setsockopt() for PACKET_ADD_MEMBERSHIP error");
+  }
+
+  // All frames are rejected until SetFilter replaces the filter, so the ring
+  // holds only frames accepted by the filter of the user
+  struct sock_filter reject = BPF_STMT(BPF_RET | BPF_K, 0);
+  struct sock_fprog prog;
+  prog.len = 1;
+  prog.filter = &reject;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+    perror("setsockopt() for SO_ATTACH_FILTER error");
+    return (2);
+  }
+  if (bind(fd, (struct sockaddr *) &ll, sizeof(ll)) < 0) {
+    perror("bind() of the packet socket error");
+    return (2);
+  }
+
+  return (0);
+}
+
+int RingCapture::DeviceDatalink(const char *dev) {
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, dev, IFNAMSIZ - 1);
+  if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+    std::cerr << "Couldn't get the hardware type of device " << dev << ": " << strerror(errno) << std::endl;
+    return -1;
+  }
+
+  // Frames of SOCK_RAW sockets start with the header of the device
+  switch (ifr.ifr_hwaddr.sa_family) {
+    case ARPHRD_ETHER:
+    case ARPHRD_LOOPBACK:
+      return DLT_EN10MB;
+    case ARPHRD_NONE:
+      // Tunnels without a link layer header (tun)
+      return DLT_RAW;
+    default:
+      std::cerr << "Device " << dev << " has an unsupported hardware type " <<
+        ifr.ifr_hwaddr.sa_family << ", capture it without the ring (-m)" << std::endl;
+      return -1;
+  }
+}
+
+int RingCapture::SetFilter(const std::string &filter) {
+  // The filter reads the frames with the link layer header of the device
+  pcap_t *dead = pcap_open_dead(datalink, 65535);
+  if (dead == NULL) {
+    std::cerr << "Couldn't create pcap handle for filter compilation" << std::endl;
+    return (2);
+  }
+
+  struct bpf_program fp;
+  if (pcap_compile(dead, &fp, filter.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1) {
+    std::cerr << "Couldn't parse filter " << filter << ": " << pcap_geterr(dead) << std::endl;
+    pcap_close(dead);
+    return (2);
+  }
+
+  // struct bpf_insn and struct sock_filter share the same layout
+  struct sock_fprog prog;
+  prog.len = fp.bf_len;
+  prog.filter = reinterpret_cast<struct sock_filter *>(fp.bf_insns);
+  int rc = setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+  pcap_freecode(&fp);
+  pcap_close(dead);
+  if (rc < 0) {
+    std::cerr << "Couldn't install filter " << filter << ": " << strerror(errno) << std::endl;
+    return (2);
+  }
+  return (0);
+}
+
+/**
+ * Instruction of a classic BPF program with absolute jump targets
+ */
+struct fanout_insn {
+  uint16_t code;
+  int jt;
+  int jf;
+  uint32_t k;
+};
+
+/**
+ * Returns a classic BPF program that returns a hash of the source address
+ * (and the source TCP port) of a frame. The kernel takes the result modulo
+ * the number of the sockets in the fanout group.
+ *
+ * Received frames reach the fanout without their link layer header, so the
+ * program reads the protocol from the skb and addresses the IP header
+ * relative to the network header (SKF_NET_OFF).
+ */
+static std::vector<struct sock_filter> source_hash_program(bool withPort) {
+  // Offsets relative to the network header
+  const uint32_t IP4 = SKF_NET_OFF, IP4_PROTO = IP4 + 9, IP4_SRC = IP4 + 12;
+  const uint32_t IP6 = SKF_NET_OFF, IP6_NEXT = IP6 + 6, IP6_SRC = IP6 + 8, IP6_TCP = IP6 + 40;
+
+  std::vector<struct fanout_insn> p;
+  // Labels are patched when known
+  p.push_back({BPF_LD | BPF_H | BPF_ABS, -1, -1, (uint32_t) (SKF_AD_OFF + SKF_AD_PROTOCOL)});
+  size_t is_ip4 = p.size();
+  p.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 0, ETHERTYPE_IP});
+  size_t is_ip6 = p.size();
+  p.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 0, ETHERTYPE_IPV6});
+  size_t other = p.size();
+  p.push_back({BPF_RET | BPF_K, -1, -1, 0});
+
+  // IPv4: A = source address
+  p[is_ip4].jt = p.size();
+  p[is_ip4].jf = is_ip6;
+  p.push_back({BPF_LD | BPF_W | BPF_ABS, -1, -1, IP4_SRC});
+  if (withPort) {
+    p.push_back({BPF_ST, -1, -1, 0});
+    p.push_back({BPF_LD | BPF_B | BPF_ABS, -1, -1, IP4_PROTO});
+    size_t is_tcp = p.size();
+    p.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 0, IPPROTO_TCP});
+    p[is_tcp].jt = p.size();
+    // X = IP header length, A = source port + source address
+    p.push_back({BPF_LDX | BPF_B | BPF_MSH, -1, -1, IP4});
+    p.push_back({BPF_LD | BPF_H | BPF_IND, -1, -1, IP4});
+    p.push_back({BPF_LDX | BPF_MEM, -1, -1, 0});
+    p.push_back({BPF_ALU | BPF_ADD | BPF_X, -1, -1, 0});
+    p.push_back({BPF_RET | BPF_A, -1, -1, 0});
+    p[is_tcp].jf = p.size();
+    p.push_back({BPF_LD | BPF_MEM, -1, -1, 0});
+  }
+  p.push_back({BPF_RET | BPF_A, -1, -1, 0});
+
+  // IPv6: A = xor of the four words of the source address
+  p[is_ip6].jt = p.size();
+  p[is_ip6].jf = other;
+  p.push_back({BPF_LD | BPF_W | BPF_ABS, -1, -1, IP6_SRC});
+  for (uint32_t word = 1; word < 4; word++) {
+    p.push_back({BPF_MISC | BPF_TAX, -1, -1, 0});
+    p.push_back({BPF_LD | BPF_W | BPF_ABS, -1, -1, IP6_SRC + 4 * word});
+    p.push_back({BPF_ALU | BPF_XOR | BPF_X, -1, -1, 0});
+  }
+  if (withPort) {
+    p.push_back({BPF_ST, -1, -1, 0});
+    p.push_back({BPF_LD | BPF_B | BPF_ABS, -1, -1, IP6_NEXT});
+    size_t is_tcp = p.size();
+    p.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 0, IPPROTO_TCP});
+    p[is_tcp].jt = p.size();
+    p.push_back({BPF_LD | BPF_H | BPF_ABS, -1, -1, IP6_TCP});
+    p.push_back({BPF_LDX | BPF_MEM, -1, -1, 0});
+    p.push_back({BPF_ALU | BPF_ADD | BPF_X, -1, -1, 0});
+    p.push_back({BPF_RET | BPF_A, -1, -1, 0});
+    p[is_tcp].jf = p.size();
+    p.push_back({BPF_LD | BPF_MEM, -1, -1, 0});
+  }
+  p.push_back({BPF_RET | BPF_A, -1, -1, 0});
+
+  // Convert absolute jump targets to offsets relative to the next instruction
+  std::vector<struct sock_filter> program;
+  for (size_t i = 0; i < p.size(); i++) {
+    struct sock_filter insn;
+    insn.code = p[i].code;
+    insn.jt = (p[i].jt < 0) ? 0 : p[i].jt - i - 1;
+    insn.jf = (p[i].jf < 0) ? 0 : p[i].jf - i - 1;
+    insn.k = p[i].k;
+    program.push_back(insn);
+  }
+  return program;
+}
+
+int RingCapture::JoinFanout(unsigned int groupId, bool withPort) {
+  int fanout = (groupId & 0xffff) | ((PACKET_FANOUT_CBPF | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+  if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+    perror("setsockopt() for PACKET_FANOUT error");
+    return (2);
+  }
+
+  std::vector<struct sock_filter> program = source_hash_program(withPort);
+  struct sock_fprog prog;
+  prog.len = program.size();
+  prog.filter = program.data();
+  if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT_DATA, &prog, sizeof(prog)) < 0) {
+    perror("setsockopt() for PACKET_FANOUT_DATA error");
+    return (2);
+  }
+  return (0);
+}
+
+int RingCapture::Loop(int count, pcap_handler callback, u_char *user) {
+  int processed = 0;
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN | POLLERR;
+  pfd.revents = 0;
+
+  while (!breakLoop) {
+    struct tpacket_block_desc *block = reinterpret_cast<struct tpacket_block_desc *>(
+        ring + (size_t) currentBlock * req.tp_block_size);
+
+    if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+      if (poll(&pfd, 1, POLL_TIMEOUT) < 0 && errno != EINTR) {
+        perror("poll() on the ring error");
+        return (-1);
+      }
+      continue;
+    }
+
+    // Hand all frames of the block to the callback, directly from the ring
+    unsigned int frames = block->hdr.bh1.num_pkts;
+    struct tpacket3_hdr *frame = reinterpret_cast<struct tpacket3_hdr *>(
+        reinterpret_cast<uint8_t *>(block) + block->hdr.bh1.offset_to_first_pkt);
+    for (unsigned int i = 0; i < frames && !breakLoop; i++) {
+      struct pcap_pkthdr header;
+      header.ts.tv_sec = frame->tp_sec;
+      header.ts.tv_usec = frame->tp_nsec / 1000;
+      header.caplen = frame->tp_snaplen;
+      header.len = frame->tp_len;
+      callback(user, &header, reinterpret_cast<uint8_t *>(frame) + frame->tp_mac);
+
+      processed++;
+      if (count > 0 && processed >= count) {
+        breakLoop = 1;
+      }
+      frame = reinterpret_cast<struct tpacket3_hdr *>(reinterpret_cast<uint8_t *>(frame) + frame->tp_next_offset);
+    }
+
+    // Return the block to the kernel
+    __sync_synchronize();
+    block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    currentBlock = (currentBlock + 1) % req.tp_block_nr;
+  }
+
+  return (0);
+}
+
+void RingCapture::UpdateStatistics() {
+  if (fd < 0) {
+    return;
+  }
+  struct tpacket_stats_v3 stats;
+  socklen_t len = sizeof(stats);
+  if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0) {
+    return;
+  }
+  // tp_packets includes the dropped frames
+  packetsReceived += stats.tp_packets;
+  packetsDropped += stats.tp_drops;
+  queueFreezes += stats.tp_freeze_q_cnt;
+}
+
+void RingCapture::PrintStatistics() {
+  UpdateStatistics();
+  std::cerr << "Ring statistics: " << packetsReceived << " frames received, " <<
+    packetsDropped << " dropped, " << queueFreezes << " queue freezes" << std::endl;
+}
+
+void RingCapture::Close() {
+  if (ring != NULL) {
+    munmap(ring, (size_t) req.tp_block_size * req.tp_block_nr);
+    ring = NULL;
+  }
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RING_CAPTURE_H
+#define _RING_CAPTURE_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <string>
+
+#include <pcap.h>
+#include <linux/if_packet.h>
+
+/**
+ * Capture backend reading frames from a memory-mapped AF_PACKET TPACKET_V3
+ * ring. The kernel fills whole blocks of frames, the frames are handed to
+ * the pcap style callback directly from the ring without any copying.
+ */
+class RingCapture {
+  // Attributes
+  private:
+    /// Packet socket
+    int fd;
+    /// Mapped ring
+    uint8_t *ring;
+    /// Ring geometry
+    struct tpacket_req3 req;
+    /// Block that is going to be processed next
+    unsigned int currentBlock;
+    /// Link layer type of the frames in the ring (DLT_*)
+    int datalink;
+    /// Set asynchronously (from a signal handler) to stop the loop
+    volatile sig_atomic_t breakLoop;
+
+    /// Statistics accumulated from PACKET_STATISTICS (the kernel resets them on read)
+    uint64_t packetsReceived;
+    uint64_t packetsDropped;
+    uint64_t queueFreezes;
+
+  // Constructors, destructors
+  public:
+    RingCapture(): fd(-1), ring(NULL), currentBlock(0), datalink(DLT_EN10MB), breakLoop(0),
+      packetsReceived(0), packetsDropped(0), queueFreezes(0) {}
+
+    ~RingCapture();
+
+  // Public methods
+  public:
+    /**
+     * Opens the packet socket and maps the ring. The link layer type of the
+     * frames is derived from the hardware type of the device, a device whose
+     * frames cannot be parsed (and "any") is refused.
+     * @param[in] dev Name of the device
+     * @param[in] blockSize Size of a ring block in bytes (multiple of page size)
+     * @param[in] blockCount Number of blocks in the ring
+     * @param[in] frameSize Size of a frame slot in bytes
+     * @return 0 if ok
+     */
+    int Open(const char *dev, unsigned int blockSize, unsigned int blockCount, unsigned int frameSize);
+
+    /**
+     * Compiles the pcap filter expression and attaches it to the socket. The
+     * opened socket rejects all frames, no frame is captured before the filter
+     * is set.
+     * @param[in] filter Filter expression in pcap syntax
+     * @return 0 if ok
+     */
+    int SetFilter(const std::string &filter);
+
+    /**
+     * Joins a PACKET_FANOUT group. The frames are distributed among the sockets
+     * of the group by their source address so that all frames of one source
+     * are always processed by the same socket.
+     * @param[in] groupId Identifier of the fanout group
+     * @param[in] withPort Distribute by the source address and TCP port
+     * @return 0 if ok
+     */
+    int JoinFanout(unsigned int groupId, bool withPort);
+
+    /**
+     * Processes frames until count frames are processed or BreakLoop is called
+     * @param[in] count Number of frames to process (0 or less for infinity)
+     * @param[in] callback Callback called for each frame
+     * @param[in] user User parameter of the callback
+     * @return 0 if ok, -1 on error
+     */
+    int Loop(int count, pcap_handler callback, u_char *user);
+
+    /// Link layer type of the frames in the ring (DLT_*)
+    int get_datalink() const
+    {
+      return datalink;
+    }
+
+    /// Stops the loop, safe to be called from a signal handler
+    void BreakLoop()
+    {
+      breakLoop = 1;
+    }
+
+    /// Reads the kernel counters and prints ring statistics to stderr
+    void PrintStatistics();
+
+    /// Closes the socket and unmaps the ring
+    void Close();
+
+  // Private methods
+  private:
+    /// Adds the kernel counters to the accumulated statistics
+    void UpdateStatistics();
+
+    /**
+     * Finds the link layer type of frames of a device
+     * @return DLT_* or -1 if the frames of the device are not supported
+     */
+    int DeviceDatalink(const char *dev);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sys/stat.h>
+#include <vector>
+
+#include "SavedComputers.h"
+#include "check_computers.h"
+
+void SavedComputers::Refresh()
+{
+  time_t now = time(NULL);
+  if (now == checked) {
+    return;
+  }
+  checked = now;
+
+  // The newer file wins, the binary store when both are of the same age
+  FileVersion xmlModified = file_version(database);
+  FileVersion storeModified = file_version(store);
+  bool useStore = storeModified.exists() && !xmlModified.newer_than(storeModified);
+  FileVersion newest = useStore ? storeModified : xmlModified;
+
+  if (!newest.exists()) {
+    // The database was removed
+    if (modified.exists()) {
+      table = std::make_shared<FingerprintStore>();
+      modified = FileVersion();
+      version++;
+    }
+    return;
+  }
+  if (newest == modified && useStore == binary) {
+    return;
+  }
+
+  std::shared_ptr<FingerprintStore> loaded = std::make_shared<FingerprintStore>();
+  if (useStore) {
+    if (loaded->Open(store) != 0) {
+      std::cerr << "Failed to open the store of saved computers " << store << std::endl;
+      // Do not try again until the file changes
+      modified = newest;
+      binary = useStore;
+      return;
+    }
+  }
+  else {
+    std::vector<SavedComputer> computers;
+    if (!load_saved_computers(database.c_str(), computers) || loaded->Build(computers) != 0) {
+      // Keep the old table, the file may be being written
+      return;
+    }
+  }
+  table = loaded;
+  modified = newest;
+  binary = useStore;
+  version++;
+}
+
+SavedComputers::FileVersion SavedComputers::file_version(const std::string &filename)
+{
+  FileVersion version = FileVersion();
+  struct stat info;
+  if (!filename.empty() && stat(filename.c_str(), &info) == 0) {
+    version.seconds = info.st_mtim.tv_sec;
+    version.nanoseconds = info.st_mtim.tv_nsec;
+    version.size = info.st_size;
+    version.inode = info.st_ino;
+  }
+  return version;
+}
+
+void SavedComputers::Find(double skew, double threshold, identity_container &identities)
+{
+  Refresh();
+  table->Find(skew, threshold, identities);
+}
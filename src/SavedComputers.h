@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SAVED_COMPUTERS_H
+#define _SAVED_COMPUTERS_H
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+#include "FingerprintStore.h"
+
+/**
+ * Known computers saved by the web interface (database.xml) or imported into
+ * the binary store (database.pcfs). The newer of the files is used, the
+ * binary store is mapped, database.xml is loaded and sorted by the skew. The
+ * files are checked at most once per second and reloaded when their
+ * modification time (in nanoseconds), size or inode changes, the new table
+ * replaces the old one only if it was loaded completely.
+ *
+ * The class is not thread safe, it is used under the group lock.
+ */
+class SavedComputers {
+  // Private types
+  private:
+    /// Identification of a version of a file
+    struct FileVersion {
+      time_t seconds;
+      long nanoseconds;
+      off_t size;
+      ino_t inode;
+
+      bool exists() const
+      {
+        return seconds != 0 || nanoseconds != 0;
+      }
+
+      bool newer_than(const FileVersion &other) const
+      {
+        return seconds > other.seconds || (seconds == other.seconds && nanoseconds > other.nanoseconds);
+      }
+
+      bool operator==(const FileVersion &other) const
+      {
+        return seconds == other.seconds && nanoseconds == other.nanoseconds &&
+          size == other.size && inode == other.inode;
+      }
+    };
+
+  // Attributes
+  private:
+    std::string database;
+    std::string store;
+    /// Computers sorted by skew
+    std::shared_ptr<const FingerprintStore> table;
+    /// Version of the loaded file, its time is 0 if nothing is loaded
+    FileVersion modified;
+    /// The loaded file is the binary store
+    bool binary;
+    time_t checked;
+    /// Number of times the table was replaced
+    unsigned long version;
+
+  // Constructors, destructors
+  public:
+    SavedComputers(): database(), store(), table(std::make_shared<FingerprintStore>()),
+      modified(), binary(false), checked(0), version(0) {}
+
+  // Public methods
+  public:
+    /**
+     * Sets the database files, they are loaded with the first search
+     * @param[in] xmlFile Filename of the XML database
+     * @param[in] storeFile Filename of the binary store
+     */
+    void set_filenames(const std::string &xmlFile, const std::string &storeFile)
+    {
+      database = xmlFile;
+      store = storeFile;
+    }
+
+    /**
+     * Finds saved computers with a similar skew
+     * @param[in] skew Skew to be searched
+     * @param[in] threshold Threshold for the similar skew
+     * @param[inout] identities Names of similar computers are added here
+     */
+    void Find(double skew, double threshold, identity_container &identities);
+
+    /// Reloads the database if the file has changed
+    void Refresh();
+
+    /// Returns a version that changes whenever the saved computers change
+    unsigned long get_version() const
+    {
+      return version;
+    }
+
+  // Private methods
+  private:
+    /// Version of a file, its time is 0 if the file does not exist
+    static FileVersion file_version(const std::string &filename);
+};
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include "SimilarityGraph.h"
+
+int SimilarityGraph::get_id(ComputerInfo *computer)
+{
+  auto found = ids.find(computer);
+  if (found != ids.end()) {
+    return found->second;
+  }
+
+  int id;
+  if (!unused.empty()) {
+    id = unused.back();
+    unused.pop_back();
+    hosts[id] = computer;
+  }
+  else {
+    id = hosts.size();
+    hosts.push_back(computer);
+    neighbors.push_back(std::vector<int>());
+    parent.push_back(id);
+    clusterSize.push_back(1);
+    versions.push_back(0);
+  }
+  ids[computer] = id;
+  touch(id);
+  return id;
+}
+
+int SimilarityGraph::find(int id)
+{
+  while (parent[id] != id) {
+    parent[id] = parent[parent[id]];
+    id = parent[id];
+  }
+  return id;
+}
+
+void SimilarityGraph::join(int a, int b)
+{
+  a = find(a);
+  b = find(b);
+  if (a == b) {
+    return;
+  }
+  if (clusterSize[a] < clusterSize[b]) {
+    std::swap(a, b);
+  }
+  parent[b] = a;
+  clusterSize[a] += clusterSize[b];
+}
+
+void SimilarityGraph::collect_clusters(std::vector<int> &members) const
+{
+  std::vector<bool> seen(hosts.size(), false);
+  for (auto it = members.begin(); it != members.end(); ++it) {
+    seen[*it] = true;
+  }
+  for (size_t i = 0; i < members.size(); i++) {
+    const std::vector<int> &edges = neighbors[members[i]];
+    for (auto it = edges.begin(); it != edges.end(); ++it) {
+      if (!seen[*it]) {
+        seen[*it] = true;
+        members.push_back(*it);
+      }
+    }
+  }
+}
+
+void SimilarityGraph::rebuild(const std::vector<int> &members)
+{
+  for (auto it = members.begin(); it != members.end(); ++it) {
+    parent[*it] = *it;
+    clusterSize[*it] = 1;
+  }
+  for (auto it = members.begin(); it != members.end(); ++it) {
+    const std::vector<int> &edges = neighbors[*it];
+    for (auto edge = edges.begin(); edge != edges.end(); ++edge) {
+      join(*it, *edge);
+    }
+  }
+}
+
+int SimilarityGraph::cluster_of(int id)
+{
+  return neighbors[id].empty() ? -1 : find(id);
+}
+
+void SimilarityGraph::touch(int id)
+{
+  versions[id] = ++lastVersion;
+}
+
+void SimilarityGraph::touch_moved(const std::vector<int> &members, const std::vector<int> &oldClusters)
+{
+  for (size_t i = 0; i < members.size(); i++) {
+    if (cluster_of(members[i]) != oldClusters[i]) {
+      touch(members[i]);
+    }
+  }
+}
+
+void SimilarityGraph::SetNeighbors(ComputerInfo *computer, const std::vector<ComputerInfo *> &similar,
+    std::vector<ComputerInfo *> &removed, std::vector<ComputerInfo *> &added)
+{
+  if (similar.empty() && ids.find(computer) == ids.end()) {
+    // Computers without similar computers are not stored
+    return;
+  }
+  int id = get_id(computer);
+
+  std::vector<int> edges;
+  edges.reserve(similar.size());
+  for (auto it = similar.begin(); it != similar.end(); ++it) {
+    edges.push_back(get_id(*it));
+  }
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<int> &oldEdges = neighbors[id];
+  std::vector<int> lost;
+  std::vector<int> gained;
+  std::set_difference(oldEdges.begin(), oldEdges.end(), edges.begin(), edges.end(), std::back_inserter(lost));
+  std::set_difference(edges.begin(), edges.end(), oldEdges.begin(), oldEdges.end(), std::back_inserter(gained));
+  if (lost.empty() && gained.empty()) {
+    return;
+  }
+
+  // Clusters of the computer and of the gained computers are rebuilt, lost
+  // computers belong to the cluster of the computer
+  std::vector<int> affected(1, id);
+  affected.insert(affected.end(), gained.begin(), gained.end());
+  collect_clusters(affected);
+  std::vector<int> oldClusters;
+  oldClusters.reserve(affected.size());
+  for (auto it = affected.begin(); it != affected.end(); ++it) {
+    oldClusters.push_back(cluster_of(*it));
+  }
+
+  for (auto it = lost.begin(); it != lost.end(); ++it) {
+    std::vector<int> &other = neighbors[*it];
+    other.erase(std::lower_bound(other.begin(), other.end(), id));
+    removed.push_back(hosts[*it]);
+    touch(*it);
+  }
+  for (auto it = gained.begin(); it != gained.end(); ++it) {
+    std::vector<int> &other = neighbors[*it];
+    other.insert(std::lower_bound(other.begin(), other.end(), id), id);
+    added.push_back(hosts[*it]);
+    touch(*it);
+  }
+  neighbors[id].swap(edges);
+  touch(id);
+
+  rebuild(affected);
+  touch_moved(affected, oldClusters);
+}
+
+void SimilarityGraph::Erase(ComputerInfo *computer)
+{
+  auto found = ids.find(computer);
+  if (found == ids.end()) {
+    return;
+  }
+  int id = found->second;
+
+  std::vector<int> oldCluster(1, id);
+  collect_clusters(oldCluster);
+  std::vector<int> oldClusters;
+  oldClusters.reserve(oldCluster.size());
+  for (auto it = oldCluster.begin(); it != oldCluster.end(); ++it) {
+    oldClusters.push_back(cluster_of(*it));
+  }
+  std::vector<int> &edges = neighbors[id];
+  for (auto it = edges.begin(); it != edges.end(); ++it) {
+    std::vector<int> &other = neighbors[*it];
+    other.erase(std::lower_bound(other.begin(), other.end(), id));
+    touch(*it);
+  }
+  edges.clear();
+  rebuild(oldCluster);
+  touch_moved(oldCluster, oldClusters);
+
+  hosts[id] = NULL;
+  ids.erase(found);
+  unused.push_back(id);
+}
+
+void SimilarityGraph::Neighbors(ComputerInfo *computer, std::vector<ComputerInfo *> &similar) const
+{
+  auto found = ids.find(computer);
+  if (found == ids.end()) {
+    return;
+  }
+  const std::vector<int> &edges = neighbors[found->second];
+  for (auto it = edges.begin(); it != edges.end(); ++it) {
+    similar.push_back(hosts[*it]);
+  }
+}
+
+void SimilarityGraph::ClusterMembers(ComputerInfo *computer, std::vector<ComputerInfo *> &members) const
+{
+  auto found = ids.find(computer);
+  if (found == ids.end()) {
+    members.push_back(computer);
+    return;
+  }
+  std::vector<int> cluster(1, found->second);
+  collect_clusters(cluster);
+  for (auto it = cluster.begin(); it != cluster.end(); ++it) {
+    members.push_back(hosts[*it]);
+  }
+}
+
+int SimilarityGraph::Cluster(ComputerInfo *computer)
+{
+  auto found = ids.find(computer);
+  if (found == ids.end() || neighbors[found->second].empty()) {
+    return -1;
+  }
+  return find(found->second);
+}
+
+unsigned long SimilarityGraph::Version(ComputerInfo *computer) const
+{
+  auto found = ids.find(computer);
+  if (found == ids.end()) {
+    return 0;
+  }
+  return versions[found->second];
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIMILARITY_GRAPH_H
+#define _SIMILARITY_GRAPH_H
+
+#include <unordered_map>
+#include <vector>
+
+class ComputerInfo;
+
+/**
+ * Graph of computers with similar clock skew, maintained incrementally. An
+ * edge connects two computers whose published skews are similar, the edges
+ * of a computer are replaced when its skew is published. Computers are
+ * represented by integer identifiers, their addresses are resolved only when
+ * they are written out.
+ *
+ * Connected components (clusters of computers that may be the same device)
+ * are kept in a union-find structure. A new edge joins two clusters, a
+ * removed edge rebuilds only the cluster it belonged to.
+ *
+ * Each computer has a version that changes whenever its similar computers or
+ * its cluster change, so readers can tell whether what they derived from the
+ * graph is still valid without computing it again.
+ */
+class SimilarityGraph {
+  // Attributes
+  private:
+    std::unordered_map<ComputerInfo *, int> ids;
+    /// Computer of each identifier, NULL for an unused identifier
+    std::vector<ComputerInfo *> hosts;
+    /// Sorted identifiers of similar computers
+    std::vector<std::vector<int> > neighbors;
+    /// Union-find of clusters
+    std::vector<int> parent;
+    std::vector<int> clusterSize;
+    std::vector<int> unused;
+    /// Version of the edges and the cluster of each identifier
+    std::vector<unsigned long> versions;
+    unsigned long lastVersion;
+
+  // Constructors, destructors
+  public:
+    SimilarityGraph(): ids(), hosts(), neighbors(), parent(), clusterSize(), unused(),
+      versions(), lastVersion(0) {}
+
+  // Public methods
+  public:
+    /**
+     * Replaces edges of a computer
+     * @param[in] computer Computer whose skew was published
+     * @param[in] similar Computers with a similar skew
+     * @param[out] removed Computers that are no longer similar
+     * @param[out] added Computers that became similar
+     */
+    void SetNeighbors(ComputerInfo *computer, const std::vector<ComputerInfo *> &similar,
+        std::vector<ComputerInfo *> &removed, std::vector<ComputerInfo *> &added);
+
+    /// Removes a computer and its edges
+    void Erase(ComputerInfo *computer);
+
+    /**
+     * Lists computers with a similar skew
+     * @param[in] computer Reference computer
+     * @param[out] similar Computers connected to the reference computer
+     */
+    void Neighbors(ComputerInfo *computer, std::vector<ComputerInfo *> &similar) const;
+
+    /**
+     * Lists computers of the cluster of a computer
+     * @param[in] computer Reference computer
+     * @param[out] members The reference computer and computers connected to it through edges
+     */
+    void ClusterMembers(ComputerInfo *computer, std::vector<ComputerInfo *> &members) const;
+
+    /**
+     * Returns the cluster of a computer
+     * @return Cluster identifier or -1 if the computer has no similar computer
+     */
+    int Cluster(ComputerInfo *computer);
+
+    /**
+     * Returns the version of the similar computers and the cluster of a computer
+     * @return Version that changes with them, 0 if the computer has no similar computer yet
+     */
+    unsigned long Version(ComputerInfo *computer) const;
+
+  // Private methods
+  private:
+    int get_id(ComputerInfo *computer);
+
+    int find(int id);
+
+    void join(int a, int b);
+
+    /// Adds the rest of the clusters of the given identifiers by walking their edges
+    void collect_clusters(std::vector<int> &members) const;
+
+    /// Computes clusters of the given computers again from their edges
+    void rebuild(const std::vector<int> &members);
+
+    /// Cluster of an identifier as returned by Cluster()
+    int cluster_of(int id);
+
+    /// Changes the version of an identifier
+    void touch(int id);
+
+    /// Changes versions of the given identifiers whose cluster differs from the old one
+    void touch_moved(const std::vector<int> &members, const std::vector<int> &oldClusters);
+};
+
+#endif
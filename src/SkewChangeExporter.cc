@@ -21,17 +21,28 @@
 #include "SkewChangeExporter.h"
 
 #include <iostream>
+#include <pthread.h>
+#include <sstream>
+
+/// Exporters of all types run in their own threads and share stdout
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
 
 void SkewChangeExporter::Notify(std::string activity, const AnalysisInfo& changed_skew)
 {
 #ifdef DEBUG
   printf("SkewChangeExporter::notify %s\n", changed_skew.Address.c_str());
 #endif
-  std::cout << activity << '\t' << source_type << '\t' << changed_skew.Address << '\t';
+  // The line is written at once so that lines of other exporters are not mixed in
+  std::ostringstream line;
+  line << activity << '\t' << source_type << '\t' << changed_skew.Address << '\t';
   for (auto it = changed_skew.SimilarIdentities.begin(); it != changed_skew.SimilarIdentities.end(); ++it) {
-    std::cout << *it << '\t';
+    line << *it << '\t';
   }
-  std::cout << std::endl;
+  line << '\n';
+
+  pthread_mutex_lock(&output_lock);
+  std::cout << line.str() << std::flush;
+  pthread_mutex_unlock(&output_lock);
 }
 
 
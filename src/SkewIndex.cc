@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SkewIndex.h"
+
+/**
+ * The same test as in TimeSegmentList::is_similar_with, ranges of alpha
+ * closer than threshold
+ */
+static bool close_ranges(double min1, double max1, double min2, double max2, double threshold)
+{
+  return !(min1 - max2 >= threshold || min2 - max1 >= threshold);
+}
+
+void SkewIndex::Update(ComputerInfo *computer, const TimeSegmentList &skew)
+{
+  Erase(computer);
+  if (skew.empty()) {
+    return;
+  }
+
+  Position position;
+  double min = skew.get_min_alpha();
+  double max = skew.get_max_alpha();
+  position.point = (min == max);
+  if (position.point) {
+    position.pointPosition = points.insert(std::make_pair(min, computer));
+  }
+  else {
+    position.intervalPosition = intervals.insert(std::make_pair(min, std::make_pair(max, computer)));
+    position.widthPosition = widths.insert(max - min);
+  }
+  positions[computer] = position;
+}
+
+void SkewIndex::Erase(ComputerInfo *computer)
+{
+  auto found = positions.find(computer);
+  if (found == positions.end()) {
+    return;
+  }
+  Position &position = found->second;
+  if (position.point) {
+    points.erase(position.pointPosition);
+  }
+  else {
+    intervals.erase(position.intervalPosition);
+    widths.erase(position.widthPosition);
+  }
+  positions.erase(found);
+}
+
+void SkewIndex::FindCandidates(const TimeSegmentList &skew, double threshold,
+    std::vector<ComputerInfo *> &candidates) const
+{
+  if (skew.empty()) {
+    return;
+  }
+  double min = skew.get_min_alpha();
+  double max = skew.get_max_alpha();
+  // The searched keys are wider than the threshold, so that rounding of the
+  // bounds does not lose a candidate, close_ranges decides
+  double margin = 2 * threshold;
+
+  for (auto it = points.lower_bound(min - margin); it != points.end() && it->first <= max + margin; ++it) {
+    if (close_ranges(min, max, it->first, it->first, threshold)) {
+      candidates.push_back(it->second);
+    }
+  }
+
+  if (intervals.empty()) {
+    return;
+  }
+  double widest = *widths.rbegin();
+  for (auto it = intervals.lower_bound(min - margin - widest);
+      it != intervals.end() && it->first <= max + margin; ++it) {
+    if (close_ranges(min, max, it->first, it->second.first, threshold)) {
+      candidates.push_back(it->second.second);
+    }
+  }
+}
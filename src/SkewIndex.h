@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SKEW_INDEX_H
+#define _SKEW_INDEX_H
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "TimeSegmentList.h"
+
+class ComputerInfo;
+
+/**
+ * Index of published clock skews by their range of alpha. Skews whose alphas
+ * are further than the threshold from each other are never similar, so the
+ * index returns only candidates that TimeSegmentList::is_similar_with has to
+ * check.
+ *
+ * Skews with a single alpha (most of computers) are points in a sorted map,
+ * they are found in O(log N + candidates). Changing skews are intervals
+ * sorted by their minimal alpha, the search is extended by the widest
+ * interval, so all intervals that start within that width below the searched
+ * range are scanned. One very wide interval makes the search of intervals
+ * O(number of intervals); changing skews are rare, so it is not worth an
+ * interval tree.
+ */
+class SkewIndex {
+  // Private types
+  private:
+    typedef std::multimap<double, ComputerInfo *> point_map;
+    /// Minimal alpha -> (maximal alpha, computer)
+    typedef std::multimap<double, std::pair<double, ComputerInfo *> > interval_map;
+
+    struct Position {
+      bool point;
+      point_map::iterator pointPosition;
+      interval_map::iterator intervalPosition;
+      std::multiset<double>::iterator widthPosition;
+    };
+
+  // Attributes
+  private:
+    point_map points;
+    interval_map intervals;
+    /// Widths of all intervals, the last one is the widest
+    std::multiset<double> widths;
+    std::unordered_map<ComputerInfo *, Position> positions;
+
+  // Constructors, destructors
+  public:
+    SkewIndex(): points(), intervals(), widths(), positions() {}
+
+  // Public methods
+  public:
+    /**
+     * Indexes the new skew of a computer
+     * @param[in] computer Computer whose skew was published
+     * @param[in] skew The published skew, a computer without atoms is not indexed
+     */
+    void Update(ComputerInfo *computer, const TimeSegmentList &skew);
+
+    /// Removes a computer from the index
+    void Erase(ComputerInfo *computer);
+
+    /**
+     * Finds computers that may have a skew similar to the given skew
+     * @param[in] skew Reference skew
+     * @param[in] threshold Similarity threshold of alpha
+     * @param[out] candidates Computers whose range of alpha is closer than
+     * threshold (including the owner of the reference skew)
+     */
+    void FindCandidates(const TimeSegmentList &skew, double threshold,
+        std::vector<ComputerInfo *> &candidates) const;
+};
+
+#endif
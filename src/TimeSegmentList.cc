@@ -21,9 +21,48 @@
 #include <algorithm>
 #include "TimeSegmentList.h"
 
+static bool ends_before(const TimeSegment &atom, double time)
+{
+  return atom.endTime < time;
+}
+
+static bool starts_after(double time, const TimeSegment &atom)
+{
+  return time < atom.startTime;
+}
+
+void TimeSegmentList::find_range(double start, double end, const_iterator &first, const_iterator &last) const
+{
+  const std::vector<TimeSegment> &segments = atoms->segments;
+  if (!atoms->ordered) {
+    first = segments.cbegin();
+    last = segments.cend();
+    return;
+  }
+  first = std::lower_bound(segments.cbegin(), segments.cend(), start, ends_before);
+  last = std::upper_bound(first, segments.cend(), end, starts_after);
+}
+
 bool TimeSegmentList::is_similar_with(const TimeSegmentList &other, const double THRESHOLD) const {
+  if (atoms->segments.empty() || other.atoms->segments.empty()) {
+    return false;
+  }
+
+  // No alpha of one skew is close to any alpha of the other skew
+  if (atoms->minAlpha - other.atoms->maxAlpha >= THRESHOLD ||
+      other.atoms->minAlpha - atoms->maxAlpha >= THRESHOLD) {
+    return false;
+  }
+
   if (is_constant() && other.is_constant()) {
-    return similar_alpha(atoms.begin()->alpha, other.atoms.begin()->alpha, THRESHOLD);
+    return similar_alpha(atoms->segments.front().alpha, other.atoms->segments.front().alpha, THRESHOLD);
+  }
+
+  // Skews that were never measured at the same time are not similar
+  if (atoms->ordered && other.atoms->ordered &&
+      (atoms->segments.back().endTime <= other.atoms->segments.front().startTime ||
+       other.atoms->segments.back().endTime <= atoms->segments.front().startTime)) {
+    return false;
   }
 
   return compare_changing(other, THRESHOLD);
@@ -35,10 +74,17 @@ bool TimeSegmentList::compare_changing(const TimeSegmentList &other, const doubl
   double both_active = 0.0;
   double similar_skew = 0.0;
 
-  std::list<TimeSegment>::const_iterator itt = atoms.begin();
-  std::list<TimeSegment>::const_iterator ito = other.atoms.begin();
+  const_iterator itt = cbegin();
+  const_iterator this_end = cend();
+  const_iterator ito = other.cbegin();
+  const_iterator other_end = other.cend();
+  // Atoms outside of the other skew would be skipped one by one
+  if (atoms->ordered && other.atoms->ordered) {
+    find_range(other.atoms->segments.front().startTime, other.atoms->segments.back().endTime, itt, this_end);
+    other.find_range(atoms->segments.front().startTime, atoms->segments.back().endTime, ito, other_end);
+  }
 
-  while (itt != atoms.end() && ito != other.atoms.end()) {
+  while (itt != this_end && ito != other_end) {
     if (itt->endTime < ito->startTime) {
       ++itt;
     }
@@ -21,17 +21,47 @@
 #ifndef _SKEW_H
 #define _SKEW_H
 
+#include <algorithm>
 #include <cmath>
-#include <list>
+#include <limits>
+#include <memory>
+#include <vector>
 
 #include "TimeSegment.h"
 
+/**
+ * Clock skew of a computer over time. Atoms are immutable once they are
+ * shared: copies of the list (the published skew of a computer, AnalysisInfo
+ * passed to observers) share one vector of atoms, so a copy costs a reference
+ * count. The atoms are copied only if a shared list is changed.
+ *
+ * Atoms are stored contiguously in the order of time, together with their
+ * range of alpha that allows to reject dissimilar skews without walking the
+ * atoms.
+ */
 class TimeSegmentList
 {
+  // Public types
+  public:
+    typedef std::vector<TimeSegment>::const_iterator const_iterator;
+
+  // Private types
+  private:
+    struct Atoms {
+      std::vector<TimeSegment> segments;
+      double minAlpha;
+      double maxAlpha;
+      /// Atoms do not overlap and they are sorted by time
+      bool ordered;
+
+      Atoms(): segments(), minAlpha(std::numeric_limits<double>::infinity()),
+        maxAlpha(-std::numeric_limits<double>::infinity()), ordered(true) {}
+    };
+
   // Attributes
   private:
-    /// List of atomic skews
-    std::list<TimeSegment> atoms;
+    /// Atomic skews, shared by copies of the list
+    std::shared_ptr<Atoms> atoms;
     /**
      * Percentage of similar skew during overlaping periods of two skews so
      * they are considered to be similar. The percentage is actually divided
@@ -45,12 +75,22 @@ class TimeSegmentList
 
   // Constructors, destructors
   public:
-    TimeSegmentList(): atoms(), endTime(0.0) {}
+    TimeSegmentList(): atoms(std::make_shared<Atoms>()), endTime(0.0) {}
 
     /// Adds new atom
     void add_atom(const TimeSegment &atom)
     {
-      atoms.push_back(atom);
+      if (!atoms.unique()) {
+        atoms = std::make_shared<Atoms>(*atoms);
+      }
+      std::vector<TimeSegment> &segments = atoms->segments;
+      if (!segments.empty() && (atom.startTime < segments.back().endTime ||
+            atom.endTime < segments.back().endTime)) {
+        atoms->ordered = false;
+      }
+      segments.push_back(atom);
+      atoms->minAlpha = std::min(atoms->minAlpha, atom.alpha);
+      atoms->maxAlpha = std::max(atoms->maxAlpha, atom.alpha);
       set_end_time(atom.endTime);
     }
 
@@ -63,36 +103,58 @@ class TimeSegmentList
       return endTime;
     }
 
+    /// Returns true if no atom was measured yet
+    bool empty() const {
+      return atoms->segments.empty();
+    }
+
     /// Returns if the clock skew is constant or if it is changing over time
     bool is_constant() const {
-      return atoms.size() == 1;
+      return atoms->segments.size() == 1;
     }
 
     /// Returns last known alpha
     double get_last_alpha() const {
-      return atoms.rbegin()->alpha;
+      return atoms->segments.back().alpha;
     }
 
     double get_start_time() const {
-      return atoms.cbegin()->startTime;
+      return atoms->segments.front().startTime;
     }
 
     double get_end_time() const {
       return endTime;
     }
 
+    double get_min_alpha() const {
+      return atoms->minAlpha;
+    }
+
+    double get_max_alpha() const {
+      return atoms->maxAlpha;
+    }
+
     /// Compares if the other skew is similar to this one
     bool is_similar_with(const TimeSegmentList &other, const double THRESHOLD) const;
 
+    /**
+     * Finds atoms that overlap a time range
+     * @param[in] start Start of the range
+     * @param[in] end End of the range
+     * @param[out] first The first atom that ends at start or later
+     * @param[out] last Past the last atom that starts at end or sooner
+     */
+    void find_range(double start, double end, const_iterator &first, const_iterator &last) const;
+
     /// Iterators to stored atoms
-    std::list<TimeSegment>::const_iterator cbegin() const
+    const_iterator cbegin() const
     {
-      return atoms.cbegin();
+      return atoms->segments.cbegin();
     }
 
-    std::list<TimeSegment>::const_iterator cend() const
+    const_iterator cend() const
     {
-      return atoms.cend();
+      return atoms->segments.cend();
     }
 
   // Private methods
@@ -29,6 +29,7 @@
 #include <sstream>
 #include <string>
 #include <regex>
+#include <vector>
 
 #include <pcap.h>
 #include <arpa/inet.h>
@@ -44,274 +45,414 @@
 #include "Computations.h"
 #include "ComputerInfoList.h"
 #include "gnuplot_graph.h"
+#include "GraphScheduler.h"
+#include "EventBus.h"
+#include "OutputQueue.h"
+#include "LiveState.h"
 #include "Configurator.h"
 #include "Tools.h"
 #include "ComputerInfoIcmp.h"
 #include "SkewChangeExporter.h"
+#include "RingCapture.h"
+#include "AddressKey.h"
 
 /// Capture all packets on the wire
 #define PROMISC 1
 #define LIN_COOK_SIZE 16
+#define LIN_COOK2_SIZE 20
 
-/// Pcap session handle
-pcap_t *handle;
-
-// IPv6 addr length (39B) + '\0' + some padding
-#define ADDRESS_SIZE 64
+#ifndef ETH_P_8021AD
+#define ETH_P_8021AD 0x88A8
+#endif
+#ifndef ETH_P_QINQ1
+#define ETH_P_QINQ1 0x9100
+#endif
+#ifndef DLT_LINUX_SLL2
+#define DLT_LINUX_SLL2 276
+#endif
 
-ComputerInfoList * computersTcp;
-ComputerInfoList * computersIcmp;
-ComputerInfoList * computersJavascript;
+/// Pcap session handle
+pcap_t *handle = NULL;
+/// Capture workers, each of them has its own ring when -m is used
+std::vector<capture_worker> workers;
 
 void StopCapturing(int signum) {
-  pcap_breakloop(handle);
+  for (auto it = workers.begin(); it != workers.end(); ++it) {
+    if (it->ring != NULL)
+      it->ring->BreakLoop();
+  }
+  if (handle != NULL)
+    pcap_breakloop(handle);
 }
 
-void GotPacket(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
-  // Allocate space for an address
-  char address[ADDRESS_SIZE];
-  // port
-  u_int16_t port = 0;
+/**
+ * Processes a TCP segment, stores TCP timestamps and JavaScript timestamps
+ * @param[in] worker Capture worker
+ * @param[in] header Packet header
+ * @param[in] tcp_offset Offset of the TCP header in the packet
+ * @param[in] source Source address without port
+ * @param[in] pokeOk True if the source can be probed by ICMP
+ */
+static void ProcessTcp(capture_worker *worker, const struct pcap_pkthdr *header, const u_char *packet,
+    int tcp_offset, const AddressKey &source, bool pokeOk) {
+  ComputerInfoList *computersTcp = worker->tcp;
+  ComputerInfoList *computersIcmp = worker->icmp;
+  ComputerInfoList *computersJavascript = worker->javascript;
+  // number of processed packets
+  int &n_packets = worker->n_packets;
   // TCP header
-  const struct tcphdr *tcp = NULL;
-  // ICMP header
-  const struct icmphdr *icmp = NULL;
-  // Packet arrival time (us)
-  double arrival_time;
+  const struct tcphdr *tcp = (struct tcphdr*) (packet + tcp_offset);
   // Timestamp
   uint64_t timestamp;
-  int pokeOk = true;
-  //
-  std::string type = "";
+  bool newIp = false;
 
-  // number of processed packets
-  static int n_packets = 0;
+  u_int16_t port = ntohs(tcp->source);
+  // Source port is a part of the key only if the ports are distinguished
+  AddressKey key = source;
+  if (Configurator::instance()->portEnable)
+    key.port = port;
+  // skip TCP headers
+  int size_tcp = tcp->doff * 4;
+  if (size_tcp < 20) {
+#ifdef DEBUG
+    std::cerr << "Invalid TCP header length: " << size_tcp << " bytes" << std::endl;
+#endif
+    return;
+  }
+  
+  /// Packet arrival timearrival_time
+  double arrival_time = header->ts.tv_sec + (header->ts.tv_usec / 1000000.0);
 
-  // Sizes
-  int size_link_proto;
-  int size_ip;
-  int size_tcp;
-  bool newIp = false;
-  u_int16_t type_link_proto;
+  // Packets with 20 bytes are without TCP options, they are processed because of possible
+  // timestamps in the payload
+  if (size_tcp == 20) {
+#ifdef DEBUG
+    std::cerr << "TCP header without options" << std::endl;
+#endif
+  }
+  /// TCP options
+  u_char *tcp_options = (u_char *) (packet + tcp_offset + sizeof (struct tcphdr));
+
+  int options_size = size_tcp - 20;
+  int options_offset = 0;
 
-  // check physical layer protocol
-  if(Configurator::instance()->datalink == "EN10MB"){
-    // Ethernet header
-    const struct ether_header * ether = (struct ether_header*) packet;
-    /// Ethernet
-    size_link_proto = sizeof (struct ether_header);
-    type_link_proto = ntohs(ether->ether_type);
-    
-  }
-  else if(Configurator::instance()->datalink == "LINUX_SLL"){
-    // Linux Cooked header
-    linux_cooked_hdr * lin_cook = (linux_cooked_hdr*) packet;
-    size_link_proto = LIN_COOK_SIZE;
-    type_link_proto = ntohs(lin_cook->proto_type);
+  // TCP options
+  // +--------+--------+---------+--------+
+  // |  Kind  | Length |       Data       |
+  // +--------+--------+---------+--------+
+
+  while (options_offset < options_size) {
+    if(Configurator::instance()->tcpDisable){
+      break;
+    }
+    int kind = (int) tcp_options[options_offset];
+    int option_len = 0;
+
+    if (kind == 8) {
+      timestamp = ntohl(*((uint64_t*) (&tcp_options[options_offset + 2])));
+
+      /// Save packet
+      n_packets++;
+      newIp = !computersTcp->new_packet(key, arrival_time, timestamp);
+      if (Configurator::instance()->verbose) {
+        std::cout << n_packets << ": " << key.ToString(Configurator::instance()->portEnable) << " (TCP)" << std::endl;
+      }
+      if (newIp) {
+        if (pokeOk && !Configurator::instance()->icmpDisable)
+          computersIcmp->to_poke_or_not_to_poke(source, arrival_time);
+      }
+    }
+
+    switch (kind) {
+        /// EOL
+      case 0:
+#ifdef DEBUG
+        std::cerr << "TCP header option without timestamp" << std::endl;
+#endif
+        options_offset = options_size;
+        break;
+        /// NOP
+      case 1:
+        options_offset++;
+        break;
+      default:
+        option_len = (int) tcp_options[options_offset + 1];
+        // malformed option, stop parsing
+        if (option_len < 2) {
+          options_offset = options_size;
+          break;
+        }
+        options_offset += option_len;
+        break;
+    }
   }
-  else {
-    std::cerr<< "Unknown physical layer protocol." << std::endl;
+  
+  if(Configurator::instance()->javacriptDisable){
     return;
   }
   
-  // VLAN
-  if(type_link_proto == 0x8100){
-    type_link_proto = ntohs(*((uint16_t *)(packet + size_link_proto) + 1));
-    size_link_proto += 4;
+  // parse HTTP header
+  int remaining_length = header->len - (tcp_offset + size_tcp);
+  // TCP without HTTP
+  if (remaining_length <= 0)
+    return;
+
+  char * hl = (char*) tcp + size_tcp;
+  std::string httpRequest = "";
+  httpRequest.append(hl, remaining_length);
+
+  // find timestamp
+  size_t found = httpRequest.find("ts=");
+  if (found == std::string::npos)
+    return;
+  found = found + 3;
+  // check if enough data to read
+  if (found > httpRequest.length())
+    return;
+
+  size_t parse_pos = found;
+  uint64_t longTimestamp = Computations::ParseInteger(httpRequest, parse_pos);
+  if ((parse_pos < httpRequest.length()) && (httpRequest[parse_pos] == '.')) {
+    int dot_pos = parse_pos;
+    ++parse_pos;
+    long long decimal = Computations::ParseInteger(httpRequest, parse_pos);
+    decimal = decimal * std::pow(10, 8 - (parse_pos - dot_pos));
+    longTimestamp = longTimestamp * 10000000 + decimal;
+  }
+  if (longTimestamp == 0) {
+    return;
+  }
+  // save new packet
+  computersJavascript->new_packet(key, arrival_time, longTimestamp);
+  if (Configurator::instance()->verbose) {
+    std::cout << n_packets << ": " << key.ToString(Configurator::instance()->portEnable) << " (JS)" << std::endl;
+  }
+}
+
+/**
+ * Processes an ICMP timestamp reply
+ * @param[in] worker Capture worker
+ * @param[in] header Packet header
+ * @param[in] icmp_offset Offset of the ICMP header in the packet
+ * @param[in] source Source address
+ */
+static void ProcessIcmp(capture_worker *worker, const struct pcap_pkthdr *header, const u_char *packet,
+    int icmp_offset, const AddressKey &source) {
+  // ICMP header
+  // +--------+--------+---------+--------+
+  // |  Type  |  Code  |  Header Chcksum  |
+  // +--------+--------+---------+--------+
+  // |    Identifier   |   Sequence Num   |
+  // +--------+--------+---------+--------+
+  // |        Originate Timestamp         |
+  // +--------+--------+---------+--------+
+  // |         Recieve Timestamp          |
+  // +--------+--------+---------+--------+
+  // |        Transmit Timestamp          |
+  // +--------+--------+---------+--------+
+  const struct icmphdr *icmp = (struct icmphdr*) (packet + icmp_offset);
+
+  // packet is not ICMP timestamp reply -> throw away
+  if (icmp->type != ICMP_TSTAMPREPLY)
+    return;
+  // retrieve appropriate timestamp
+  unsigned int * newTimestamp = (unsigned int *) icmp + 3;
+  uint64_t timestamp = (uint64_t) ntohl(*newTimestamp);
+  double arrival_time = header->ts.tv_sec + (header->ts.tv_usec / 1000000.0);
+  // save packet 
+  worker->icmp->new_packet(source, arrival_time, timestamp);
+  if (Configurator::instance()->verbose) {
+    std::cout << worker->n_packets << ": " << source.IpString() << " (ICMP)" << std::endl;
   }
+}
 
+/**
+ * Processes the network layer of a packet whose link layer was already parsed
+ * @param[in] worker Capture worker
+ * @param[in] header Packet header
+ * @param[in] offset Offset of the network layer header
+ * @param[in] type_link_proto EtherType of the network layer
+ */
+static void ProcessNetwork(capture_worker *worker, const struct pcap_pkthdr *header, const u_char *packet,
+    int offset, u_int16_t type_link_proto) {
   /// IPv4
-  if (type_link_proto == 0x0800) {
+  if (type_link_proto == ETHERTYPE_IP) {
     // IP header
-    const struct ip *ip = (struct ip*) (packet + size_link_proto);
-    size_ip = sizeof (struct ip);
+    const struct ip *ip = (struct ip*) (packet + offset);
+    int size_ip = ip->ip_hl * 4;
+    if (size_ip < (int) sizeof (struct ip))
+      return;
     // Check if the packet is ICMP or TCP
-    if (ip->ip_p == IPPROTO_ICMP) {
-      type = "icmp";
-      icmp = (struct icmphdr*) (packet + size_link_proto + size_ip);
-    } else if (ip->ip_p == IPPROTO_TCP) {
-      type = "tcp";
-      tcp = (struct tcphdr*) (packet + size_link_proto + size_ip);
-    } else
+    if (ip->ip_p != IPPROTO_ICMP && ip->ip_p != IPPROTO_TCP)
       return;
 
-    // get IP address
-    if (inet_ntop(AF_INET, &(ip->ip_src), address, 64) == NULL) {
-      fprintf(stderr, "Cannot get IP address\n");
-      return;
-    }
+    AddressKey source = AddressKey::FromIPv4(ip->ip_src);
+    if (ip->ip_p == IPPROTO_ICMP)
+      ProcessIcmp(worker, header, packet, offset + size_ip, source);
+    else
+      ProcessTcp(worker, header, packet, offset + size_ip, source, true);
   }    /// IPv6
-  else if (type_link_proto == 0x86dd) {
+  else if (type_link_proto == ETHERTYPE_IPV6) {
     // IP header
-    pokeOk = false;
-    const struct ip6_hdr *ip = (struct ip6_hdr*) (packet + size_link_proto);
-    size_ip = sizeof (struct ip6_hdr);
+    const struct ip6_hdr *ip = (struct ip6_hdr*) (packet + offset);
     /// Check if the packet is TCP
     if (ip->ip6_ctlun.ip6_un1.ip6_un1_nxt != IPPROTO_TCP)
       return;
-    type = "tcp";
-    /// TCP
-    tcp = (struct tcphdr*) (packet + size_link_proto + size_ip);
-    if (inet_ntop(AF_INET6, &(ip->ip6_src), address, 64) == NULL) {
-      fprintf(stderr, "Cannot get IP address\n");
-      return;
-    }
+    /// TCP, ICMP probing is IPv4 only
+    ProcessTcp(worker, header, packet, offset + sizeof (struct ip6_hdr), AddressKey::FromIPv6(ip->ip6_src), false);
   } else {
     fprintf(stderr, "Unknown Ethernet type\n");
-    return;
   }
+}
 
-  if (type == "tcp") {
-    port = ntohs(tcp->source);
-    // skip TCP headers
-    size_tcp = tcp->doff * 4;
-    if (size_tcp < 20) {
-#ifdef DEBUG
-      std::cerr << "Invalid TCP header length: " << size_tcp << " bytes" << std::endl;
-#endif
-      return;
-    }
-    
-    /// Packet arrival timearrival_time
-    arrival_time = header->ts.tv_sec + (header->ts.tv_usec / 1000000.0);
+/**
+ * Returns true for EtherTypes of VLAN tags (802.1Q, 802.1ad and the
+ * pre-standard QinQ tag)
+ */
+static inline bool IsVlan(u_int16_t type_link_proto) {
+  return type_link_proto == ETHERTYPE_VLAN || type_link_proto == ETH_P_8021AD ||
+    type_link_proto == ETH_P_QINQ1;
+}
 
-    // Packets with 20 bytes are without TCP options, they are processed because of possible
-    // timestamps in the payload
-    if (size_tcp == 20) {
-#ifdef DEBUG
-      std::cerr << "TCP header without options" << std::endl;
-#endif
-    }
-    /// TCP options
-    u_char *tcp_options = (u_char *) (packet + size_link_proto + size_ip + sizeof (struct tcphdr));
+/**
+ * Maps address family of DLT_NULL/DLT_LOOP header to EtherType. IPv6 has
+ * different values on different systems.
+ */
+static inline u_int16_t FamilyToEthertype(u_int32_t family) {
+  switch (family) {
+    case 2:
+      return ETHERTYPE_IP;
+    case 10: // Linux
+    case 24: // NetBSD, OpenBSD
+    case 28: // FreeBSD
+    case 30: // Darwin
+      return ETHERTYPE_IPV6;
+    default:
+      return 0;
+  }
+}
 
-    int options_size = size_tcp - 20;
-    int options_offset = 0;
+/**
+ * Parses the link layer header of the given datalink type
+ * @param[in] header Packet header
+ * @param[out] offset Offset of the network layer header
+ * @param[out] type_link_proto EtherType of the network layer
+ * @return false if the packet is too short or of an unknown type
+ */
+template <int DLT>
+static inline bool ParseLink(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto);
+
+template <>
+inline bool ParseLink<DLT_EN10MB>(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto) {
+  // Ethernet header
+  const struct ether_header * ether = (struct ether_header*) packet;
+  offset = sizeof (struct ether_header);
+  type_link_proto = ntohs(ether->ether_type);
+  return header->caplen >= (bpf_u_int32) offset;
+}
 
-    // TCP options
-    // +--------+--------+---------+--------+
-    // |  Kind  | Length |       Data       |
-    // +--------+--------+---------+--------+
+template <>
+inline bool ParseLink<DLT_LINUX_SLL>(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto) {
+  // Linux Cooked header
+  linux_cooked_hdr * lin_cook = (linux_cooked_hdr*) packet;
+  offset = LIN_COOK_SIZE;
+  type_link_proto = ntohs(lin_cook->proto_type);
+  return header->caplen >= (bpf_u_int32) offset;
+}
 
-    while (options_offset < options_size) {
-      if(Configurator::instance()->tcpDisable){
-        break;
-      }
-      int kind = (int) tcp_options[options_offset];
-      int option_len = 0;
-
-      if (kind == 8) {
-        timestamp = ntohl(*((uint64_t*) (&tcp_options[options_offset + 2])));
-
-        /// Save packet
-        n_packets++;
-        newIp = !computersTcp->new_packet(address, port, arrival_time, timestamp);
-        if (Configurator::instance()->verbose) {
-          if(Configurator::instance()->portEnable)
-            std::cout << n_packets << ": " << address << "_" << port << " (TCP)" << std::endl;
-          else
-            std::cout << n_packets << ": " << address << " (TCP)" << std::endl;
-        }
-        if (newIp) {
-          if (pokeOk && !Configurator::instance()->icmpDisable)
-            computersIcmp->to_poke_or_not_to_poke(address);
-        }
-      }
+template <>
+inline bool ParseLink<DLT_LINUX_SLL2>(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto) {
+  // Linux Cooked v2 header, the protocol is the first field
+  offset = LIN_COOK2_SIZE;
+  type_link_proto = ntohs(*((u_int16_t *) packet));
+  return header->caplen >= (bpf_u_int32) offset;
+}
 
-      switch (kind) {
-          /// EOL
-        case 0:
-#ifdef DEBUG
-          std::cerr << "TCP header option without timestamp" << std::endl;
-#endif
-          options_offset = options_size;
-          break;
-          /// NOP
-        case 1:
-          options_offset++;
-          break;
-        default:
-          option_len = (int) tcp_options[options_offset + 1];
-          options_offset += option_len;
-          break;
-      }
-    }
-    
-    if(Configurator::instance()->javacriptDisable){
-      return;
-    }
-    
-    // parse HTTP header
-    int remaining_length = header->len - (size_link_proto + size_ip + size_tcp);
-    // TCP without HTTP
-    if (remaining_length == 0)
-      return;
+template <>
+inline bool ParseLink<DLT_RAW>(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto) {
+  // No link layer header, IP version decides
+  offset = 0;
+  if (header->caplen < 1)
+    return false;
+  switch (packet[0] >> 4) {
+    case 4:
+      type_link_proto = ETHERTYPE_IP;
+      return true;
+    case 6:
+      type_link_proto = ETHERTYPE_IPV6;
+      return true;
+    default:
+      return false;
+  }
+}
 
-    char * hl = (char*) tcp + size_tcp;
-    std::string httpRequest = "";
-    httpRequest.append(hl, remaining_length);
+template <>
+inline bool ParseLink<DLT_NULL>(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto) {
+  // BSD loopback, the family is in the byte order of the capturing host
+  offset = 4;
+  if (header->caplen < (bpf_u_int32) offset)
+    return false;
+  u_int32_t family = *((u_int32_t *) packet);
+  if (family > 0xffff)
+    family = __builtin_bswap32(family);
+  type_link_proto = FamilyToEthertype(family);
+  return type_link_proto != 0;
+}
 
-    // find timestamp
-    size_t found = httpRequest.find("ts=");
-    if (found < 0)
-      return;
-    found = found + 3;
-    // check if enough data to read
-    if (found > httpRequest.length())
-      return;
+template <>
+inline bool ParseLink<DLT_LOOP>(const struct pcap_pkthdr *header, const u_char *packet, int &offset, u_int16_t &type_link_proto) {
+  // OpenBSD loopback, the family is in the network byte order
+  offset = 4;
+  if (header->caplen < (bpf_u_int32) offset)
+    return false;
+  type_link_proto = FamilyToEthertype(ntohl(*((u_int32_t *) packet)));
+  return type_link_proto != 0;
+}
 
-    size_t parse_pos = found;
-    uint64_t longTimestamp = Computations::ParseInteger(httpRequest, parse_pos);
-    if ((parse_pos < httpRequest.length()) && (httpRequest[parse_pos] == '.')) {
-      int dot_pos = parse_pos;
-      ++parse_pos;
-      long long decimal = Computations::ParseInteger(httpRequest, parse_pos);
-      decimal = decimal * std::pow(10, 8 - (parse_pos - dot_pos));
-      longTimestamp = longTimestamp * 10000000 + decimal;
-    }
-    if (longTimestamp == 0) {
-      return;
-    }
-    // save new packet
-    computersJavascript->new_packet(address, port, arrival_time, longTimestamp);
-    if (Configurator::instance()->verbose) {
-      if(Configurator::instance()->portEnable)
-        std::cout << n_packets << ": " << address << "_" << port << " (JS)" << std::endl;
-      else
-        std::cout << n_packets << ": " << address << " (JS)" << std::endl;
-    }
-    return; // Packet processed
-
-
-  } else if (type == "icmp") {
-    // ICMP header
-    // +--------+--------+---------+--------+
-    // |  Type  |  Code  |  Header Chcksum  |
-    // +--------+--------+---------+--------+
-    // |    Identifier   |   Sequence Num   |
-    // +--------+--------+---------+--------+
-    // |        Originate Timestamp         |
-    // +--------+--------+---------+--------+
-    // |         Recieve Timestamp          |
-    // +--------+--------+---------+--------+
-    // |        Transmit Timestamp          |
-    // +--------+--------+---------+--------+
-
-    // packet is not ICMP timestamp reply -> throw away
-    if (icmp->type != ICMP_TSTAMPREPLY)
-      return;
-    // retrieve appropriate timestamp
-    unsigned int * newTimestamp = (unsigned int *) icmp + 3;
-    timestamp = (uint64_t) ntohl(*newTimestamp);
-    arrival_time = header->ts.tv_sec + (header->ts.tv_usec / 1000000.0);
-    // save packet 
-    computersIcmp->new_packet(address, 0, arrival_time, timestamp);
-    if (Configurator::instance()->verbose) {
-      std::cout << n_packets << ": " << address << " (ICMP)" << std::endl;
-    }
-    // packet processed
+/**
+ * Callback function for pcap specialized for one datalink type
+ */
+template <int DLT>
+static void GotPacket(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
+  int offset;
+  u_int16_t type_link_proto;
+
+  if (!ParseLink<DLT>(header, packet, offset, type_link_proto)) {
     return;
   }
+
+  // VLAN, possibly stacked
+  while (IsVlan(type_link_proto)) {
+    if (header->caplen < (bpf_u_int32) offset + 4)
+      return;
+    type_link_proto = ntohs(*((uint16_t *)(packet + offset) + 1));
+    offset += 4;
+  }
+
+  ProcessNetwork((capture_worker *) args, header, packet, offset, type_link_proto);
+}
+
+pcap_handler GetPacketHandler(int datalink) {
+  switch (datalink) {
+    case DLT_EN10MB:
+      return GotPacket<DLT_EN10MB>;
+    case DLT_LINUX_SLL:
+      return GotPacket<DLT_LINUX_SLL>;
+    case DLT_LINUX_SLL2:
+      return GotPacket<DLT_LINUX_SLL2>;
+    case DLT_RAW:
+#if defined(DLT_IPV4) && defined(DLT_IPV6)
+    case DLT_IPV4:
+    case DLT_IPV6:
+#endif
+      return GotPacket<DLT_RAW>;
+    case DLT_NULL:
+      return GotPacket<DLT_NULL>;
+    case DLT_LOOP:
+      return GotPacket<DLT_LOOP>;
+    default:
+      return NULL;
+  }
 }
 
 int liveCapturing(){
@@ -380,6 +521,37 @@ int liveCapturing(){
   return 0;
 }
 
+int ringCapturing(){
+  /// Checking permissions (must be root)
+  if (getuid()) {
+    fprintf(stderr, "Must have root permissions to run this program!\n");
+    return (2);
+  }
+
+  for (auto it = workers.begin(); it != workers.end(); ++it) {
+    it->ring = new RingCapture();
+    if (it->ring->Open(Configurator::instance()->dev, Configurator::instance()->ringBlockSize,
+          Configurator::instance()->ringBlockCount, Configurator::instance()->ringFrameSize)) {
+      std::cerr << "Couldn't open ring on device " << Configurator::instance()->dev << std::endl;
+      return (2);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Thread of a capture worker, processes frames from its ring
+ */
+void * captureWorker(void *arg) {
+  capture_worker *worker = static_cast<capture_worker *>(arg);
+  if (worker->ring->Loop(Configurator::instance()->number, GetPacketHandler(worker->ring->get_datalink()), (u_char *) worker) == -1) {
+    std::cerr << "An error occured during capturing from the ring" << std::endl;
+  }
+  // One finished worker (packet limit, error) stops the others
+  StopCapturing(0);
+  return NULL;
+}
+
 int offlineCapturing(){
   // Error string
   char errbuf[PCAP_ERRBUF_SIZE];
@@ -396,8 +568,24 @@ int StartCapturing() {
   std::string filter;
   // Compiled filter expr.
   struct bpf_program fp;
+
+  // More workers are possible only for live capture through the ring
+  unsigned int workers_count = Configurator::instance()->workers;
+  if (workers_count > 1 && (!Configurator::instance()->ring || !Configurator::instance()->datafile.empty())) {
+    std::cerr << "More capture workers need live capture through the ring (-m), using one worker" << std::endl;
+    workers_count = 1;
+  }
+  capture_worker worker_template = {NULL, NULL, NULL, NULL, pthread_t(), 0};
+  workers.assign(workers_count, worker_template);
+
   /// Open the device for sniffing
-  if(Configurator::instance()->datafile.empty()){
+  if(Configurator::instance()->datafile.empty() && Configurator::instance()->ring){
+    // each worker opens its ring
+    if(ringCapturing()){
+      return(2);
+    }
+  }
+  else if(Configurator::instance()->datafile.empty()){
     if(liveCapturing()){
       return(2);
     }
@@ -447,15 +635,33 @@ int StartCapturing() {
   std::cout << "Filter: " << filter << std::endl;
 #endif
 
-  if (pcap_compile(handle, &fp, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1) {
-    std::cerr << "Couldn't parse filter " << filter << ": " << pcap_geterr(handle) << std::endl;
-    return (2);
+  if (workers[0].ring != NULL) {
+    // Frames of one source address are always processed by the same worker.
+    // The rings reject all frames until their filter is set, so all workers
+    // join the group before any of them receives a frame and the distribution
+    // does not change afterwards.
+    if (workers.size() > 1) {
+      for (auto it = workers.begin(); it != workers.end(); ++it) {
+        if (it->ring->JoinFanout(getpid(), Configurator::instance()->portEnable))
+          return (2);
+      }
+    }
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+      if (it->ring->SetFilter(filter))
+        return (2);
+    }
   }
+  else {
+    if (pcap_compile(handle, &fp, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1) {
+      std::cerr << "Couldn't parse filter " << filter << ": " << pcap_geterr(handle) << std::endl;
+      return (2);
+    }
 
-  /// Apply the filter
-  if (pcap_setfilter(handle, &fp) == -1) {
-    std::cerr << "Couldn't install filter " << filter << ": " << pcap_geterr(handle) << std::endl;
-    return (2);
+    /// Apply the filter
+    if (pcap_setfilter(handle, &fp) == -1) {
+      std::cerr << "Couldn't install filter " << filter << ": " << pcap_geterr(handle) << std::endl;
+      return (2);
+    }
   }
 
   /// Set alarm (if any)
@@ -464,23 +670,55 @@ int StartCapturing() {
     alarm(Configurator::instance()->time);
   }
 
-  computersTcp = new ComputerInfoList("tcp");
-  computersJavascript = new ComputerInfoList("javascript");
-  computersIcmp = new ComputerInfoList("icmp");
+  // Each worker has its own shard of TCP and JavaScript computers, all
+  // shards of one type form a group with merged active.xml and similarity.
+  // ICMP replies arrive at most once per second per computer, all workers
+  // share one list.
+  ShardGroup groupTcp;
+  ShardGroup groupJavascript;
+  ComputerInfoList *computersIcmp = new ComputerInfoList("icmp", NULL, workers.size() > 1);
   // ComputerInfoList computers(Configurator::instance()->active, Configurator::instance()->database, Configurator::instance()->block, Configurator::instance()->timeLimit, Configurator::instance()->threshold);
   
   gnuplot_graph graph_creator_tcp("tcp");
   gnuplot_graph graph_creator_javascript("javascript");
   gnuplot_graph graph_creator_icmp("icmp");
-  
-  computersTcp->AddObserver(&graph_creator_tcp);
-  computersIcmp->AddObserver(&graph_creator_icmp);
-  computersJavascript->AddObserver(&graph_creator_javascript);
-  
+  // Graphs are regenerated by background threads, at most once per interval
+  GraphScheduler graph_scheduler_tcp(graph_creator_tcp);
+  GraphScheduler graph_scheduler_javascript(graph_creator_javascript);
+  GraphScheduler graph_scheduler_icmp(graph_creator_icmp);
+  SkewChangeExporter exporter_tcp("tcp");
+  SkewChangeExporter exporter_javascript("javascript");
+  SkewChangeExporter exporter_icmp("icmp");
+
+  // Observers are notified by their own threads, a slow observer does not
+  // stall the capture
+  OverflowPolicy export_policy;
+  if (!EventBus::ParsePolicy(Configurator::instance()->exportOverflow, export_policy)) {
+    std::cerr << "Unknown EXPORT_OVERFLOW policy: " << Configurator::instance()->exportOverflow << std::endl;
+    return (2);
+  }
+  size_t queue_size = Configurator::instance()->eventQueueSize;
+  EventBus bus_tcp;
+  EventBus bus_javascript;
+  EventBus bus_icmp;
+  bus_tcp.Subscribe(&graph_scheduler_tcp, OVERFLOW_COALESCE, queue_size);
+  bus_javascript.Subscribe(&graph_scheduler_javascript, OVERFLOW_COALESCE, queue_size);
+  bus_icmp.Subscribe(&graph_scheduler_icmp, OVERFLOW_COALESCE, queue_size);
   if (Configurator::instance()->exportSkewChanges) {
-    computersTcp->AddObserver(new SkewChangeExporter("tcp"));
-    computersIcmp->AddObserver(new SkewChangeExporter("icmp"));
-    computersJavascript->AddObserver(new SkewChangeExporter("javascript"));
+    bus_tcp.Subscribe(&exporter_tcp, export_policy, queue_size);
+    bus_javascript.Subscribe(&exporter_javascript, export_policy, queue_size);
+    bus_icmp.Subscribe(&exporter_icmp, export_policy, queue_size);
+  }
+
+  computersIcmp->AddObserver(&bus_icmp);
+
+  for (auto it = workers.begin(); it != workers.end(); ++it) {
+    it->tcp = new ComputerInfoList("tcp", &groupTcp);
+    it->javascript = new ComputerInfoList("javascript", &groupJavascript);
+    it->icmp = computersIcmp;
+
+    it->tcp->AddObserver(&bus_tcp);
+    it->javascript->AddObserver(&bus_javascript);
   }
 
   /// Set interrupt signal (ctrl-c or SIGTERM during capturing means stop capturing)
@@ -505,6 +743,14 @@ int StartCapturing() {
     return (2);
   }
 
+  // Computers are published into the shared live state whenever their skew
+  // is computed, the state is created before any worker asks for it
+  LiveState *liveState = LiveState::instance();
+  if (!Configurator::instance()->sharedState.empty() &&
+      liveState->Open(Configurator::instance()->sharedState, Configurator::instance()->sharedStateHosts) != 0) {
+    return (2);
+  }
+
   /// Print actual time
   if (Configurator::instance()->verbose) {
     time_t rawtime;
@@ -512,27 +758,84 @@ int StartCapturing() {
     std::cout << "Capturing started at: " << ctime(&rawtime) << std::endl;
   }
   
-  Configurator::instance()->datalink = pcap_datalink_val_to_name(pcap_datalink(handle));
+  if (workers[0].ring != NULL) {
+    // Frames in the ring start with the link layer header of the device
+    Configurator::instance()->datalink = pcap_datalink_val_to_name(workers[0].ring->get_datalink());
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+      if (pthread_create(&it->thread, NULL, captureWorker, &*it) != 0) {
+        std::cerr << "Couldn't start capture worker" << std::endl;
+        StopCapturing(0);
+        workers.erase(it, workers.end());
+        break;
+      }
+    }
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+      pthread_join(it->thread, NULL);
+    }
+  }
+  else {
+    int datalink = pcap_datalink(handle);
+    Configurator::instance()->datalink = pcap_datalink_val_to_name(datalink);
+    // The link layer parser is chosen once for the whole capture
+    pcap_handler handler = GetPacketHandler(datalink);
+    if (handler == NULL) {
+      std::cerr << "Unsupported datalink: " << Configurator::instance()->datalink << std::endl;
+      LiveState::instance()->Close();
+      return (2);
+    }
 
-  /// Start capturing TODO
-  if (pcap_loop(handle, Configurator::instance()->number, GotPacket, NULL) == -1) {
-    std::cerr << "An error occured during capturing: " << pcap_geterr(handle) << std::endl;
-    return (2);
+    /// Start capturing TODO
+    if (pcap_loop(handle, Configurator::instance()->number, handler, (u_char *) &workers[0]) == -1) {
+      std::cerr << "An error occured during capturing: " << pcap_geterr(handle) << std::endl;
+      LiveState::instance()->Close();
+      return (2);
+    }
   }
 
   if (!Configurator::instance()->tcpDisable) {
-    computersTcp->save_active_computers();
-    computersTcp->save_log();
+    workers[0].tcp->save_active_computers();
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+      it->tcp->save_log();
+    }
   }
   if (!Configurator::instance()->javacriptDisable) {
-    computersJavascript->save_active_computers();
-    computersJavascript->save_log();
+    workers[0].javascript->save_active_computers();
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+      it->javascript->save_log();
+    }
   }
   if (!Configurator::instance()->icmpDisable) {
     computersIcmp->save_active_computers();
   }
+  bus_tcp.Flush();
+  bus_javascript.Flush();
+  bus_icmp.Flush();
+  graph_scheduler_tcp.Flush();
+  graph_scheduler_javascript.Flush();
+  graph_scheduler_icmp.Flush();
+  OutputQueue::instance()->Flush();
+  if (Configurator::instance()->verbose) {
+    bus_tcp.PrintStatistics();
+    bus_javascript.PrintStatistics();
+    bus_icmp.PrintStatistics();
+    graph_scheduler_tcp.PrintStatistics();
+    graph_scheduler_javascript.PrintStatistics();
+    graph_scheduler_icmp.PrintStatistics();
+    OutputQueue::instance()->PrintStatistics();
+    LiveState::instance()->PrintStatistics();
+  }
+  LiveState::instance()->Close();
 
   /// Close the session
-  pcap_close(handle);
+  for (auto it = workers.begin(); it != workers.end(); ++it) {
+    if (it->ring != NULL) {
+      it->ring->PrintStatistics();
+      delete it->ring;
+      it->ring = NULL;
+    }
+  }
+  if (handle != NULL) {
+    pcap_close(handle);
+  }
   return (0);
 }
@@ -23,8 +23,12 @@
 
 #include <arpa/inet.h>
 #include <pcap.h>
+#include <pthread.h>
 #include <string>
 
+#include "ComputerInfoList.h"
+#include "RingCapture.h"
+
 
     /**
      * Capture packets
@@ -38,13 +42,28 @@
      */
      void StopCapturing(int signum);
 
+    /**
+     * Lists of computers filled by one capture worker and its capture state
+     */
+    typedef struct {
+      ComputerInfoList *tcp;
+      ComputerInfoList *icmp;
+      ComputerInfoList *javascript;
+      /// Ring of the worker (NULL when pcap is used)
+      RingCapture *ring;
+      pthread_t thread;
+      /// Number of processed packets
+      int n_packets;
+    } capture_worker;
+
     /** 
-     * Callback function for pcap
-     * @param[in] args     User params
-     * @param[in] header   Packet header
-     * @param[in] packet   Packet
+     * Returns the pcap callback specialized for the datalink type, the link
+     * layer is not decided per packet. The callback expects the capture
+     * worker (capture_worker *) as its args parameter.
+     * @param[in] datalink Datalink type (DLT_*)
+     * @return Callback or NULL if the datalink is not supported
      */
-     void GotPacket(u_char *args, const struct pcap_pkthdr *header, const u_char *packet);
+     pcap_handler GetPacketHandler(int datalink);
      
      typedef struct {
        u_int16_t pckt_type;
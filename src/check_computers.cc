@@ -32,22 +32,23 @@
 #include <stdbool.h>
 #include <string.h>
 #include <iomanip>
+#include <sstream>
 
 #include "check_computers.h"
 #include "ComputerInfo.h"
 #include "TimeSegment.h"
 #include "Configurator.h"
+#include "OutputQueue.h"
 
 
 #define MY_ENCODING "UTF-8"
 
-bool find_computer_in_saved(double referenced_skew, identity_container &identities, const double THRESHOLD, const char *database)
+bool load_saved_computers(const char *database, std::vector<SavedComputer> &computers)
 {
   /// No computers
   if (access(database, F_OK) != 0) {
-    return false;
+    return true;
   }
-  //std::cout << "-------find comp in saved--------" << std::endl;
   xmlDoc *xml_doc = xmlReadFile(database, NULL, 0);
 
   if (xml_doc == NULL) {
@@ -55,6 +56,10 @@ bool find_computer_in_saved(double referenced_skew, identity_container &identiti
   }
 
   xmlNode *root_element = xmlDocGetRootElement(xml_doc);
+  if (root_element == NULL) {
+    xmlFreeDoc(xml_doc);
+    return(false);
+  }
 
   for(xmlNode *computer_node = root_element->children; computer_node != NULL; computer_node = computer_node->next) {
 
@@ -67,31 +72,42 @@ bool find_computer_in_saved(double referenced_skew, identity_container &identiti
     }
 
     xmlChar *xml_skew_prop = xmlGetProp(computer_node, BAD_CAST "skew");
-    if (xml_skew_prop != NULL) {
-      double skew_xml = atof((char *) xml_skew_prop);
-
-      /// Comparison
-      double skew_diff = fabs(referenced_skew - skew_xml);
-      if (skew_diff < THRESHOLD) {
-        bool name_reached = false;
-        xmlNode *computer_child_node = computer_node->children;
-
-        while (!name_reached && computer_child_node != NULL) {
-          if (computer_child_node->type != XML_ELEMENT_NODE) {
-            continue;
-          }
-
-          if (strcmp((char *) computer_child_node->name, "name") == 0) {
-            xmlChar *computer_name = xmlNodeGetContent(computer_child_node);
-            if (computer_name != NULL) {
-              identities.insert((char *) computer_name);
-              name_reached = true;
-              xmlFree(computer_name);
-            }
-          }
-        }
+    if (xml_skew_prop == NULL) {
+      continue;
+    }
+    SavedComputer computer;
+    computer.skew = atof((char *) xml_skew_prop);
+    xmlFree(xml_skew_prop);
+
+    computer.frequency = 0;
+    bool name_reached = false;
+    for (xmlNode *computer_child_node = computer_node->children; computer_child_node != NULL;
+        computer_child_node = computer_child_node->next) {
+      if (computer_child_node->type != XML_ELEMENT_NODE) {
+        continue;
+      }
+
+      xmlChar *content = xmlNodeGetContent(computer_child_node);
+      if (content == NULL) {
+        continue;
+      }
+      if (strcmp((char *) computer_child_node->name, "name") == 0) {
+        computer.name = (char *) content;
+        name_reached = true;
       }
-      xmlFree(xml_skew_prop);
+      else if (strcmp((char *) computer_child_node->name, "address") == 0) {
+        computer.address = (char *) content;
+      }
+      else if (strcmp((char *) computer_child_node->name, "frequency") == 0) {
+        computer.frequency = atof((char *) content);
+      }
+      else if (strcmp((char *) computer_child_node->name, "date") == 0) {
+        computer.date = (char *) content;
+      }
+      xmlFree(content);
+    }
+    if (name_reached) {
+      computers.push_back(computer);
     }
   }
 
@@ -100,99 +116,189 @@ bool find_computer_in_saved(double referenced_skew, identity_container &identiti
   return true;
 }
 
-int save_active(const std::list<ComputerInfo *> &all_computers, const char *file, ComputerInfoList &computers)
+int save_saved_computers(const char *database, const std::vector<SavedComputer> &computers)
+{
+  xmlTextWriterPtr writer = xmlNewTextWriterFilename(database, 0);
+  if (writer == NULL) {
+    return 2;
+  }
+  xmlTextWriterSetIndent(writer, 1);
+
+  bool ok = xmlTextWriterStartDocument(writer, NULL, MY_ENCODING, NULL) >= 0 &&
+    xmlTextWriterStartElement(writer, BAD_CAST "computers") >= 0;
+  for (auto it = computers.begin(); ok && it != computers.end(); ++it) {
+    char skew[32];
+    snprintf(skew, sizeof(skew), "%.15g", it->skew);
+    ok = xmlTextWriterStartElement(writer, BAD_CAST "computer") >= 0 &&
+      xmlTextWriterWriteAttribute(writer, BAD_CAST "skew", BAD_CAST skew) >= 0 &&
+      xmlTextWriterWriteElement(writer, BAD_CAST "name", BAD_CAST it->name.c_str()) >= 0 &&
+      xmlTextWriterWriteElement(writer, BAD_CAST "address", BAD_CAST it->address.c_str()) >= 0 &&
+      xmlTextWriterWriteFormatElement(writer, BAD_CAST "frequency", "%g", it->frequency) >= 0 &&
+      xmlTextWriterWriteElement(writer, BAD_CAST "date", BAD_CAST it->date.c_str()) >= 0 &&
+      xmlTextWriterEndElement(writer) >= 0;
+  }
+  ok = ok && xmlTextWriterEndDocument(writer) >= 0;
+  xmlFreeTextWriter(writer);
+
+  return ok ? 0 : 2;
+}
+
+/// Escapes characters of text that have a special meaning in XML
+static std::string xml_escape(const std::string &text)
+{
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (auto it = text.begin(); it != text.end(); ++it) {
+    switch (*it) {
+      case '&':
+        escaped.append("&amp;");
+        break;
+      case '<':
+        escaped.append("&lt;");
+        break;
+      case '>':
+        escaped.append("&gt;");
+        break;
+      default:
+        escaped.push_back(*it);
+    }
+  }
+  return escaped;
+}
+
+/**
+ * Serializes the <computer> element of active.xml
+ * @param[in] computer Computer to be serialized
+ * @param[out] fragment Cached element with the state it was serialized from
+ */
+static void serialize_active(const ComputerInfo &computer, ActiveFragment &fragment)
+{
+  std::ostringstream tempFileStream;
+
+  /// <computer>
+  tempFileStream << "\t<computer>\n";
+
+  /// <ip>
+  tempFileStream << "\t\t<ip>" << computer.get_address() << "</ip>\n";
+
+  /// <freq>
+  tempFileStream << "\t\t<frequency>" << fragment.freq << "</frequency>\n";
+
+  /// <packets>
+  tempFileStream << "\t\t<packets>" << fragment.packets << "</packets>\n";
+
+  /// <date>
+  tempFileStream << "\t\t<date>" << ctime(&fragment.date) << "</date>\n";
+
+  /// <skews>
+  tempFileStream << "\t\t<skews>\n";
+
+  tempFileStream.setf(std::ios::fixed);
+  tempFileStream.precision(6);
+  /// <skew>
+  // resp. <skew val=x from=y to=z>
+  for (auto iter = computer.timeSegmentList.cbegin(); iter != computer.timeSegmentList.cend(); ++iter){
+    tempFileStream << "\t\t\t<skew value=\""  << iter->alpha << "\" ";
+    tempFileStream << "from=\"" << iter->relativeStartTime << "\" ";
+    tempFileStream << "to=\"" << iter->relativeEndTime << "\" ";
+    tempFileStream << "absfrom=\"" << iter->startTime << "\" ";
+    tempFileStream << "absto=\"" << iter->endTime << "\"/>\n";
+  }
+  tempFileStream.unsetf(std::ios::fixed);
+  tempFileStream << "\t\t</skews>\n";
+
+  for (auto skew_it = fragment.identities.begin(); skew_it != fragment.identities.end(); ++skew_it) {
+    /// <identity>
+    tempFileStream << "\t\t<identity>\n";
+    /// <name>
+    tempFileStream << "\t\t\t<name>"  << xml_escape(*skew_it) << "</name>\n";
+    tempFileStream << "\t\t</identity>\n";
+  }
+  /// <cluster>
+  if (fragment.cluster >= 0) {
+    tempFileStream << "\t\t<cluster>" << fragment.cluster << "</cluster>\n";
+  }
+  tempFileStream << "\t</computer>\n";
+
+  fragment.xml = tempFileStream.str();
+}
+
+int save_active(ShardGroup &group, const char *file, ComputerInfoList &computers)
 {
   // check if time limit passed
   time_t currentTime;
   time(&currentTime);
-  if((double)(currentTime - computers.lastXMLupdate) < Configurator::instance()->xmlRefreshLimit){
+  if((double)(currentTime - group.lastXMLupdate) < Configurator::instance()->xmlRefreshLimit){
     return(0);
   }
   
-  std::string tempFilename = Configurator::xmlDir + computers.getOutputDirectory() + "temp.xml";
   std::string activeFilename = Configurator::xmlDir + computers.getOutputDirectory();
   activeFilename.append(file);
-  
-  std::fstream tempFileStream;
-  tempFileStream.open(tempFilename.c_str(), std::ios::out | std::ios::trunc);
-  
-  if(!tempFileStream){
-    fprintf(stderr, "Temporary XML document could not be opened: %s\n", tempFilename.c_str());
-    return(1);
-  }
-  
-  tempFileStream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-  tempFileStream << "<computers>\n";
-  
-  for (auto it = all_computers.begin(); it != all_computers.end(); ++it) {
-    // Skip computers when frequency is 0
-    if ((*it)->get_freq() == 0) {
-      continue;
-    }
 
-    /// <computer>
-    tempFileStream << "\t<computer>\n";
-    
-    /// <ip>
-    tempFileStream << "\t\t<ip>" << (*it)->get_address() << "</ip>\n";
-    
-    /// <freq>
-    tempFileStream << "\t\t<frequency>" << (*it)->get_freq() << "</frequency>\n";
-    
-    /// <packets>
-    tempFileStream << "\t\t<packets>" << (*it)->get_packets_count() << "</packets>\n";
-    
-    /// <date>
-    const time_t last = (*it)->get_last_packet_time();
-    tempFileStream << "\t\t<date>" << ctime(&last) << "</date>\n";
-    
-    /// <skews>
-    tempFileStream << "\t\t<skews>\n";
-    
-    tempFileStream.setf(std::ios::fixed);
-    tempFileStream.precision(6);
-    /// <skew>
-    // resp. <skew val=x from=y to=z>
-    for (auto iter = ((*it)->timeSegmentList).cbegin(); iter != ((*it)->timeSegmentList).cend(); ++iter){
-      tempFileStream << "\t\t\t<skew value=\""  << iter->alpha << "\" ";
-      tempFileStream << "from=\"" << iter->relativeStartTime << "\" ";
-      tempFileStream << "to=\"" << iter->relativeEndTime << "\" ";
-      tempFileStream << "absfrom=\"" << iter->startTime << "\" ";
-      tempFileStream << "absto=\"" << iter->endTime << "\"/>\n";
-    }
-    tempFileStream.unsetf(std::ios::fixed);
-    tempFileStream << "\t\t</skews>\n";
-    
-    // find computers with similar clock skew
-    identity_container similar_skew = computers.get_similar_identities((*it)->get_address());
-    
-    for (auto skew_it = similar_skew.begin(); skew_it != similar_skew.end(); ++skew_it) {
-      /// <identity>
-      tempFileStream << "\t\t<identity>\n";
-      /// <name>
-      tempFileStream << "\t\t\t<name>"  << *skew_it << "</name>\n";
-	  tempFileStream << "\t\t</identity>\n";
-    }
-    tempFileStream << "\t</computer>\n";
+  static const char header[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<computers>\n";
+  static const char footer[] = "</computers>\n";
+
+  // Computers of other shards are changed by their workers without the group
+  // lock, their summaries are used instead. Summaries of the shard of the
+  // caller are refreshed first.
+  for (auto it = computers.get_computers().begin(); it != computers.get_computers().end(); ++it) {
+    (*it)->publish_summary();
   }
-  tempFileStream << "</computers>\n";
-  tempFileStream.close();
-
-  std::ifstream activeFileStream(activeFilename.c_str());
-  // active.xml exists and has to be removed
-  if (activeFileStream.good()) {
-    if (remove(activeFilename.c_str())) {
-      fprintf(stderr, "XML document could not be removed: %s\n", tempFilename.c_str());
-      return (1);
+
+  // Similar saved computers of all computers are looked up again only when
+  // the database changes
+  group.saved.Refresh();
+  unsigned long savedVersion = group.saved.get_version();
+
+  // Elements of computers are serialized only when their state changed
+  std::vector<const std::string *> fragments;
+  size_t size = sizeof(header) + sizeof(footer);
+  for (auto shard = group.shards.begin(); shard != group.shards.end(); ++shard) {
+    const std::list<ComputerInfo *> &all_computers = (*shard)->get_computers();
+    for (auto it = all_computers.begin(); it != all_computers.end(); ++it) {
+      ComputerInfo &computer = **it;
+      const ComputerSummary &summary = computer.summary;
+      // Skip computers when frequency is 0
+      if (summary.freq == 0) {
+        continue;
+      }
+
+      ActiveFragment &fragment = computer.activeFragment;
+      unsigned long similarityVersion = group.similarity.Version(&computer);
+      time_t last = summary.lastPacketTime;
+      if (fragment.xml.empty() || fragment.freq != summary.freq ||
+          fragment.packets != summary.packets || fragment.date != last ||
+          fragment.skewVersion != computer.skewVersion ||
+          fragment.similarityVersion != similarityVersion ||
+          fragment.savedVersion != savedVersion) {
+        fragment.freq = summary.freq;
+        fragment.packets = summary.packets;
+        fragment.date = last;
+        fragment.skewVersion = computer.skewVersion;
+        fragment.similarityVersion = similarityVersion;
+        fragment.savedVersion = savedVersion;
+        // find computers with similar clock skew
+        fragment.identities = computers.get_similar_identities(computer.get_address());
+        fragment.cluster = group.similarity.Cluster(&computer);
+        serialize_active(computer, fragment);
+      }
+      fragments.push_back(&fragment.xml);
+      size += fragment.xml.size();
     }
   }
-  
-  // rename temp.xml to active.xml
-  if (rename(tempFilename.c_str(), activeFilename.c_str())) {
-    fprintf(stderr, "XML document could not be replaced by temporary file: %s\n", tempFilename.c_str());
-    return (1);
+
+  // The document is written by the output thread at once
+  std::string document;
+  document.reserve(size);
+  document.append(header);
+  for (auto it = fragments.begin(); it != fragments.end(); ++it) {
+    document.append(**it);
   }
+  document.append(footer);
+
+  // active.xml is replaced atomically
+  OutputQueue::instance()->Replace(activeFilename, document);
   // update time of last xml refresh
-  time(&(computers.lastXMLupdate));
+  time(&(group.lastXMLupdate));
   return (0);
 }
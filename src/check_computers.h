@@ -23,6 +23,7 @@
 
 #include "TimeSegment.h"
 #include "ComputerInfoList.h"
+#include "SavedComputers.h"
 
 /**
  * Conversts time to its string representation in human readable format
@@ -33,21 +34,29 @@
 void time_to_str(char *buffer, size_t buffer_size, time_t time);
 
 /**
- * Search for computers with similar skew in saved computers
- * @param[in] referenced_skew Skew to be searched
- * @param[inout] identities Container with identities of the computer that is being searched for
- * @param[in] THRESHOLD threshold for the similar skew
+ * Loads computers saved in the XML database
  * @param[in] database Filename of XML database with saved computers and their skew
- * @return true if success, false otherwise
+ * @param[out] computers Saved computers are appended here
+ * @return true if success (a missing database is empty), false otherwise
  */
-bool find_computer_in_saved(double referenced_skew, identity_container &identities, const double THRESHOLD, const char *database);
+bool load_saved_computers(const char *database, std::vector<SavedComputer> &computers);
 
 /**
- * Save active computers into file
- * @param[in] all_computers List of active computers
+ * Writes computers into the XML database in the format of the web interface
+ * @param[in] database Filename of the XML database
+ * @param[in] computers Computers to be saved
+ * @return 0 if ok
+ */
+int save_saved_computers(const char *database, const std::vector<SavedComputer> &computers);
+
+/**
+ * Save active computers of all shards into file, the group lock has to be held.
+ * Computers of other shards are described by their summaries.
+ * @param[in] group Shards with active computers
  * @param[in] Active Fileneame of the database with active computers
+ * @param[in] computers Shard of the calling worker
  * @return 0 if ok
  */
-int save_active(const std::list<ComputerInfo *> &all_computers, const char *active, ComputerInfoList &computers);
+int save_active(ShardGroup &group, const char *active, ComputerInfoList &computers);
 
 #endif
@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+#include "FingerprintStore.h"
+#include "check_computers.h"
+
+/**
+ * Print help
+ */
+void print_help()
+{
+  printf("Usage: fingerprint_store [Options] source destination\n\n"
+         "  -h\t\tPrint this help\n"
+         "  -i\t\tImport saved computers from XML (database.xml) into the binary store\n"
+         "  -e\t\tExport saved computers from the binary store into XML\n"
+         "Examples:\n"
+         "  fingerprint_store -i www/data/database.xml www/data/database.pcfs\n"
+         "  fingerprint_store -e www/data/database.pcfs www/data/database.xml\n\n");
+}
+
+/**
+ * Main
+ */
+
+int main(int argc, char *argv[])
+{
+  int c;
+  opterr = 0;
+  bool import = false;
+  bool exportXML = false;
+  while ((c = getopt(argc, argv, "hie")) != -1) {
+    switch (c) {
+      case('i'):
+        import = true;
+        break;
+      case('e'):
+        exportXML = true;
+        break;
+      case('h'):
+        print_help();
+        return 0;
+    }
+  }
+
+  if (import == exportXML || argc - optind != 2) {
+    print_help();
+    return 2;
+  }
+  const char *source = argv[optind];
+  const char *destination = argv[optind + 1];
+
+  FingerprintStore store;
+  std::vector<SavedComputer> computers;
+  if (import) {
+    if (!load_saved_computers(source, computers)) {
+      std::cerr << "Failed to read XML database " << source << std::endl;
+      return 2;
+    }
+    if (store.Build(computers) != 0 || store.Write(destination) != 0) {
+      std::cerr << "Failed to write the store " << destination << std::endl;
+      return 2;
+    }
+  }
+  else {
+    if (store.Open(source) != 0) {
+      std::cerr << "Failed to open the store " << source << std::endl;
+      return 2;
+    }
+    computers.resize(store.size());
+    for (size_t i = 0; i < store.size(); i++) {
+      store.Get(i, computers[i]);
+    }
+    if (save_saved_computers(destination, computers) != 0) {
+      std::cerr << "Failed to write XML database " << destination << std::endl;
+      return 2;
+    }
+  }
+  std::cout << computers.size() << " computers" << std::endl;
+
+  return 0;
+}
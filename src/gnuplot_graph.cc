@@ -18,6 +18,8 @@
  * along with pcf. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <string>
@@ -25,6 +27,7 @@
 
 #include "TimeSegment.h"
 #include "gnuplot_graph.h"
+#include "OutputQueue.h"
 
 const size_t STRLEN_MAX = 100;
 
@@ -57,11 +60,14 @@ void gnuplot_graph::generate_graph(const AnalysisInfo &changed_skew)
   int filename_max = strlen(filename_template) + address.length();
   char filename[filename_max + 1];
   snprintf(filename, filename_max, filename_template, address.c_str());
-  if (computer_skew.cbegin()->alpha == 0.0 || std::isnan(computer_skew.cbegin()->alpha)) {
+  if (computer_skew.empty() || computer_skew.cbegin()->alpha == 0.0 || std::isnan(computer_skew.cbegin()->alpha)) {
     return;
   }
 
-  f = fopen(filename, "w");
+  // The script is written and plotted by the output thread
+  char *script;
+  size_t script_size;
+  f = open_memstream(&script, &script_size);
   
   if (f == NULL) {
     fprintf(stderr, "Cannot create file: %s\n", filename);
@@ -168,12 +174,13 @@ void gnuplot_graph::generate_graph(const AnalysisInfo &changed_skew)
     fputs("\" textcolor lt 2", f);
   }
   /// Plot
+  // The binary log is converted to the data file by the output thread
+  std::string samples = "log/" + getOutputDirectory() + address + ".plog";
+  std::string data = "graph/" + getOutputDirectory() + address + ".dat";
   fputs("\n\n"
         "plot '", f);
-  fputs("log/", f);
-  fputs(getOutputDirectory().c_str(), f);
-  fputs(address.c_str(), f);
-  fputs(".log' using 1:2 title ''", f);
+  fputs(data.c_str(), f);
+  fputs("' using 1:2 title ''", f);
 
   count = 1;
   for (auto it = computer_skew.cbegin(); it != computer_skew.cend(); ++it, ++count) {
@@ -205,18 +212,17 @@ void gnuplot_graph::generate_graph(const AnalysisInfo &changed_skew)
 
   fputs("\n", f);
 
-  if (fclose(f) != 0)
+  if (fclose(f) != 0) {
     fprintf(stderr, "Cannot close file: %s\n", filename);
-  
-  std::string extendedGnuplotTemplate = "gnuplot graph/" + getOutputDirectory() + "%s.gp";
-  const char* gnuplot_template =  extendedGnuplotTemplate.c_str();
-  int gnuplot_max = strlen(gnuplot_template) + address.length();
-  char gnuplot_cmd[gnuplot_max + 1];
-  snprintf(gnuplot_cmd, gnuplot_max, gnuplot_template, address.c_str());
-  
-  //
-  if(system(gnuplot_cmd) < 0)
-      fprintf(stderr, "Error while launching gnuplot\n");
+    free(script);
+    return;
+  }
+  std::string content(script, script_size);
+  free(script);
+
+  // A graph that waits for the output thread is replaced by a newer one, the
+  // script is plotted by a gnuplot process shared by all graphs
+  OutputQueue::instance()->Plot(filename, content, samples, data);
   
   return;
 }
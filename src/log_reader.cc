@@ -24,29 +24,36 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <utility>
+#include <vector>
 #include <unistd.h>
 
 #include "Configurator.h"
 #include "ComputerInfoList.h"
+#include "PacketLog.h"
+#include "OutputQueue.h"
 #include "gnuplot_graph.h"
+#include "GraphScheduler.h"
 
 /**
  * Print help
  */
 void print_help()
 {
-  printf("Usage: log_reader file\n\n"
+  printf("Usage: log_reader [Options] file...\n\n"
          "  -h\t\tPrint this help\n"
-         "  file Name of the file to be parsed\n"
+         "  -c\t\tPrint packets of binary logs as text (offset x, offset y, arrival time, timestamp)\n"
+         "  file Name of the text (.log) or binary (.plog) file to be parsed\n"
          "Examples:\n"
-         "  log_reader log/192.168.1.1\n\n");
+         "  log_reader log/tcp/192.168.1.1.plog\n"
+         "  log_reader -c log/tcp/192.168.1.1.plog\n\n");
 }
 
 
 /**
  * Read the content of the log file and process it
  */
-void process_log_file(std::ifstream &ifs, ComputerInfoList* computers,  const char* name)
+void process_log_file(std::ifstream &ifs, ComputerInfoList* computers,  const AddressKey &key)
 {
   double ttime, offset, arrival_time, timestamp;
   unsigned rows = 0;
@@ -55,12 +62,34 @@ void process_log_file(std::ifstream &ifs, ComputerInfoList* computers,  const ch
     ifs >> ttime >> offset >> arrival_time >> timestamp;
     
     if (ifs.good()) {
-      computers->new_packet(name, 0, arrival_time, timestamp);
+      computers->new_packet(key, arrival_time, timestamp);
       rows++;
     }
   }
 }
 
+/**
+ * Read packets of the last tracking of a binary log and process them. A
+ * restarted computer (e.g. after a reboot) starts a new tracking in the same
+ * log, packets of the former trackings would be rejected or mixed with it.
+ */
+void process_binary_log(FILE *f, ComputerInfoList* computers, const AddressKey &key)
+{
+  std::vector<std::pair<double, uint64_t> > samples;
+  PacketLog::Record record;
+  while (PacketLog::Read(f, record)) {
+    if (record.type == PacketLog::START) {
+      samples.clear();
+    }
+    else if (record.type == PacketLog::SAMPLE) {
+      samples.push_back(std::make_pair(record.time, record.timestamp));
+    }
+  }
+  for (auto it = samples.begin(); it != samples.end(); ++it) {
+    computers->new_packet(key, it->first, it->second);
+  }
+}
+
 /**
  * Main
  */
@@ -73,11 +102,18 @@ int main(int argc, char *argv[])
   
   int c;
   opterr = 0;
-  while ((c = getopt(argc, argv, "hrdv")) != -1) {
+  bool convert = false;
+  while ((c = getopt(argc, argv, "hrkdvc")) != -1) {
     switch (c) {
+      case('c'):
+        convert = true;
+        break;
       case('r'):
         Configurator::instance()->reduce = true;
         break;
+      case('k'):
+        Configurator::instance()->retainHullOnly = true;
+        break;
       case('h'):
         print_help();
         return 0;
@@ -91,8 +127,19 @@ int main(int argc, char *argv[])
   }
   Configurator::instance()->timeLimit = INT_MAX;
 
+  if (convert) {
+    for (int fileindex = optind; fileindex < argc; ++fileindex) {
+      if (PacketLog::PrintText(argv[fileindex], std::cout) != 0) {
+        std::cerr << "Failed to read binary log " << argv[fileindex] << std::endl;
+        return 2;
+      }
+    }
+    return 0;
+  }
+
   ComputerInfoList * computers = new ComputerInfoList("tcp");
   gnuplot_graph graph_creator("tcp");
+  GraphScheduler graph_scheduler(graph_creator);
   for (int fileindex = optind; fileindex < argc; ++fileindex) {
     // Open log file
     std::ifstream ifs (argv[fileindex], std::ifstream::in);
@@ -103,7 +150,10 @@ int main(int argc, char *argv[])
 
     std::string name = argv[fileindex];
     std::string::size_type start = name.find_last_of('/') + 1;
-    std::string::size_type end = name.rfind(".log");
+    std::string::size_type end = name.rfind(".plog");
+    if (end == std::string::npos) {
+      end = name.rfind(".log");
+    }
     if (start == std::string::npos) {
       start = 0;
     }
@@ -112,10 +162,32 @@ int main(int argc, char *argv[])
       count = end - start;
     }
 
-    process_log_file(ifs, computers, name.substr(start, count).c_str());
+    // The file is named by the address (and port) of the computer
+    AddressKey key;
+    if (!AddressKey::Parse(name.substr(start, count), key)) {
+      std::cerr << "File name " << argv[fileindex] << " is not an IP address, skipping" << std::endl;
+      continue;
+    }
+    if (!Configurator::instance()->portEnable) {
+      key.port = 0;
+    }
+    FILE *binary = PacketLog::Open(argv[fileindex]);
+    if (binary != NULL) {
+      process_binary_log(binary, computers, key);
+      fclose(binary);
+    }
+    else {
+      process_log_file(ifs, computers, key);
+    }
   }
-  computers->AddObserver(&graph_creator);
+  computers->AddObserver(&graph_scheduler);
   computers->update_all_skews();
   computers->save_active_computers();
   computers->save_log();
+  graph_scheduler.Flush();
+  OutputQueue::instance()->Flush();
+  if (Configurator::instance()->verbose) {
+    graph_scheduler.PrintStatistics();
+    OutputQueue::instance()->PrintStatistics();
+  }
 }
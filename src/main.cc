@@ -48,7 +48,7 @@ void print_banner() {
 void print_help() {
   printf("Usage: pcf [Options] [Interface]\n\n"
           "  -h\t\tPrint this help\n"
-          "  -n\t\tNumber of packets to capture (0 for infinity)\n"
+          "  -n\t\tNumber of packets to capture (0 for infinity), counted by each worker\n"
           "  -t\t\tTime for capturing (in seconds, 0 for infinity)\n"
           "  -p\t\tPort number (1-65535)\n"
           "  -i\t\tDisable ICMP\n"
@@ -56,8 +56,11 @@ void print_help() {
           "  -x\t\tDisable TCP\n"
           "  -d\t\tPair devices using port numbers, e.g. to detect devices behind NAT\n"
           "  -o filename\tRead from pcap file\n"
+          "  -m\t\tCapture through a memory-mapped ring (TPACKET_V3)\n"
+          "  -w workers\tNumber of capture workers sharing the ring traffic (needs -m)\n"
           "  -v\t\tVerbose mode\n"
           "  -r\t\tReduce packets\n"
+          "  -k\t\tKeep only packets needed for the clock skew (bounded memory)\n"
           "  -e\t\tIRI-IIF outputs\n"
           "  -f\t\tSet frequency and recompute skew after every packet\n"
           "  -s\t\tSet skew and recompute skew after every packet\n"
@@ -79,7 +82,7 @@ int main(int argc, char *argv[]) {
   /// Get params
   int c;
   opterr = 0;
-  while ((c = getopt(argc, argv, "ivhbxes:f:q:n:t:p:jdo:r")) != -1) {
+  while ((c = getopt(argc, argv, "ivhbxes:f:q:n:t:p:jdo:rkmw:")) != -1) {
     switch (c) {
       case('i'):
         Configurator::instance()->icmpDisable = true;
@@ -144,6 +147,18 @@ int main(int argc, char *argv[]) {
       case 'r':
           Configurator::instance()->reduce = true;
         break;
+      case 'k':
+          Configurator::instance()->retainHullOnly = true;
+        break;
+      case 'm':
+          Configurator::instance()->ring = true;
+        break;
+      case 'w':
+        if (atoi(optarg) > 0)
+          Configurator::instance()->workers = atoi(optarg);
+        else
+          fprintf(stderr, "Wrong number of workers\n");
+        break;
     }
   }
   c = optind;
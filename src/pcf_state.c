@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The reader is plain C so that it can be built into other programs */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pcf_state.h"
+
+/* Pcf is checked after this number of failed attempts to copy a slot */
+#define PCF_STATE_CHECK_ATTEMPTS 1024
+/* A slot that is not consistent after this number of checks is given up */
+#define PCF_STATE_CHECKS 64
+
+int pcf_state_open(const char *name, struct pcf_state *state)
+{
+  struct stat info;
+  void *mapped;
+  const struct pcf_state_header *header;
+  int fd = shm_open(name, O_RDONLY, 0);
+
+  state->header = NULL;
+  state->hosts = NULL;
+  state->size = 0;
+  if (fd < 0) {
+    return 2;
+  }
+  if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(struct pcf_state_header)) {
+    close(fd);
+    return 2;
+  }
+  mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return 2;
+  }
+
+  header = (const struct pcf_state_header *) mapped;
+  if (memcmp(header->magic, PCF_STATE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != PCF_STATE_VERSION || header->hostSize != sizeof(struct pcf_state_host) ||
+      header->capacity > (info.st_size - sizeof(struct pcf_state_header)) / sizeof(struct pcf_state_host)) {
+    munmap(mapped, info.st_size);
+    return 2;
+  }
+
+  state->header = header;
+  state->hosts = (const struct pcf_state_host *) (header + 1);
+  state->size = info.st_size;
+  return 0;
+}
+
+void pcf_state_close(struct pcf_state *state)
+{
+  if (state->header != NULL) {
+    munmap((void *) state->header, state->size);
+  }
+  state->header = NULL;
+  state->hosts = NULL;
+  state->size = 0;
+}
+
+uint32_t pcf_state_count(const struct pcf_state *state)
+{
+  uint32_t used = __atomic_load_n(&state->header->used, __ATOMIC_ACQUIRE);
+  return used < state->header->capacity ? used : state->header->capacity;
+}
+
+int pcf_state_read_host(const struct pcf_state *state, uint32_t i, struct pcf_state_host *host)
+{
+  const struct pcf_state_host *slot = state->hosts + i;
+  uint32_t before;
+  uint32_t after;
+  uint32_t countersBefore;
+  uint32_t countersAfter;
+  unsigned int attempts = 0;
+  unsigned int checks = 0;
+
+  while (1) {
+    before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    countersBefore = __atomic_load_n(&slot->countersSequence, __ATOMIC_ACQUIRE);
+    if (((before | countersBefore) & 1) == 0) {
+      memcpy(host, slot, sizeof(*host));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      after = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+      countersAfter = __atomic_load_n(&slot->countersSequence, __ATOMIC_RELAXED);
+      if (before == after && countersBefore == countersAfter) {
+        break;
+      }
+    }
+
+    /* The sequence stays odd forever if pcf died in the middle of a write */
+    if (++attempts % PCF_STATE_CHECK_ATTEMPTS == 0) {
+      if ((kill(state->header->pid, 0) != 0 && errno == ESRCH) || ++checks == PCF_STATE_CHECKS) {
+        return -1;
+      }
+      sched_yield();
+    }
+  }
+
+  host->type[PCF_STATE_TYPE - 1] = '\0';
+  host->address[PCF_STATE_ADDRESS - 1] = '\0';
+  return host->active != 0;
+}
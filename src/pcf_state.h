@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Live state of active computers exported by pcf through POSIX shared memory
+ * (config key SHARED_STATE) and a small C library to read it.
+ *
+ * The segment starts with struct pcf_state_header followed by capacity slots
+ * of struct pcf_state_host. A slot has two parts, each protected by its own
+ * sequence lock: the skew and the cluster are changed whenever the skew or
+ * the cluster changes, the counters are changed with every packet of the
+ * computer. Pcf makes the sequence odd, changes the part and makes it even
+ * again. A reader copies the slot and retries when a sequence was odd or
+ * changed meanwhile, so readers never block pcf and need no file I/O. All
+ * fields are in the host byte order.
+ */
+
+#ifndef _PCF_STATE_H
+#define _PCF_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PCF_STATE_MAGIC "PCFSTAT1"
+#define PCF_STATE_VERSION 1
+/** Maximal length of the type and the address including the terminating zero */
+#define PCF_STATE_TYPE 16
+#define PCF_STATE_ADDRESS 64
+/** Number of the newest segments of the clock skew kept in a slot */
+#define PCF_STATE_SEGMENTS 16
+
+struct pcf_state_header {
+  char magic[8];
+  uint32_t version;
+  /** Size of struct pcf_state_host */
+  uint32_t hostSize;
+  /** Number of slots */
+  uint32_t capacity;
+  /** Slots above this index were never used */
+  uint32_t used;
+  /** Process ID of pcf */
+  uint32_t pid;
+  uint32_t reserved;
+};
+
+/** Segment of the clock skew, times are absolute */
+struct pcf_state_segment {
+  double alpha;
+  double startTime;
+  double endTime;
+};
+
+struct pcf_state_host {
+  /** Odd while the skew part of the slot is being changed */
+  uint32_t sequence;
+  /** 0 for a free slot */
+  uint32_t active;
+  char type[PCF_STATE_TYPE];
+  char address[PCF_STATE_ADDRESS];
+  /** Cluster of computers with similar clock skew, -1 if there is none */
+  int32_t cluster;
+  /** Number of all segments of the clock skew, the last min(segments, PCF_STATE_SEGMENTS) are stored */
+  uint32_t segments;
+  struct pcf_state_segment segment[PCF_STATE_SEGMENTS];
+  /** Odd while the counters are being changed */
+  uint32_t countersSequence;
+  int32_t frequency;
+  uint64_t packets;
+  double lastPacketTime;
+};
+
+/** Mapped live state */
+struct pcf_state {
+  const struct pcf_state_header *header;
+  const struct pcf_state_host *hosts;
+  size_t size;
+};
+
+/**
+ * Maps the live state
+ * @param[in] name Name of the shared memory object (e.g. "/pcf")
+ * @param[out] state Mapped state
+ * @return 0 if ok, 2 if the state does not exist or it is of a different version
+ */
+int pcf_state_open(const char *name, struct pcf_state *state);
+
+/** Unmaps the live state */
+void pcf_state_close(struct pcf_state *state);
+
+/** Returns the number of slots that may be active */
+uint32_t pcf_state_count(const struct pcf_state *state);
+
+/**
+ * Copies a consistent snapshot of a slot
+ * @param[in] state Mapped state
+ * @param[in] i Index of the slot, lower than pcf_state_count()
+ * @param[out] host Copy of the slot
+ * @return 1 if the slot holds an active computer, 0 otherwise, -1 if no
+ * consistent snapshot was copied (pcf exited while it was changing the slot
+ * or it keeps changing the slot)
+ */
+int pcf_state_read_host(const struct pcf_state *state, uint32_t i, struct pcf_state_host *host);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
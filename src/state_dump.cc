@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2013 Libor Polčák <ipolcak@fit.vutbr.cz>
+ *
+ * This file is part of pcf - PC fingerprinter.
+ *
+ * Pcf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Pcf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pcf. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include "pcf_state.h"
+
+/**
+ * Print help
+ */
+void print_help()
+{
+  printf("Usage: state_dump [Options] name\n\n"
+         "  -h\t\tPrint this help\n"
+         "  -w seconds\tPrint the state repeatedly\n"
+         "  name Name of the shared memory object (SHARED_STATE in config)\n"
+         "Prints active computers: type, address, frequency, packets, cluster,\n"
+         "number of skew segments and the last skew\n"
+         "Examples:\n"
+         "  state_dump /pcf\n"
+         "  state_dump -w 1 /pcf\n\n");
+}
+
+/**
+ * Print all active computers of the state
+ * @return 0 if ok, 2 if a slot cannot be read (pcf exited while writing it)
+ */
+int dump(const struct pcf_state &state)
+{
+  struct pcf_state_host host;
+  uint32_t count = pcf_state_count(&state);
+  for (uint32_t i = 0; i < count; i++) {
+    int active = pcf_state_read_host(&state, i, &host);
+    if (active < 0) {
+      std::cerr << "Slot " << i << " cannot be read consistently" << std::endl;
+      return 2;
+    }
+    if (!active) {
+      continue;
+    }
+    printf("%s\t%s\t%d\t%llu\t%d\t%u", host.type, host.address, host.frequency,
+        (unsigned long long) host.packets, host.cluster, host.segments);
+    if (host.segments > 0) {
+      uint32_t kept = host.segments < PCF_STATE_SEGMENTS ? host.segments : PCF_STATE_SEGMENTS;
+      printf("\t%f", host.segment[kept - 1].alpha);
+    }
+    printf("\n");
+  }
+  return 0;
+}
+
+/**
+ * Main
+ */
+
+int main(int argc, char *argv[])
+{
+  int c;
+  opterr = 0;
+  double interval = 0;
+  while ((c = getopt(argc, argv, "hw:")) != -1) {
+    switch (c) {
+      case('w'):
+        interval = atof(optarg);
+        break;
+      case('h'):
+        print_help();
+        return 0;
+    }
+  }
+
+  if (argc - optind != 1) {
+    print_help();
+    return 2;
+  }
+
+  struct pcf_state state;
+  if (pcf_state_open(argv[optind], &state) != 0) {
+    std::cerr << "Failed to open the shared state " << argv[optind] << std::endl;
+    return 2;
+  }
+  int result = dump(state);
+  while (result == 0 && interval > 0) {
+    usleep(interval * 1000000);
+    printf("\n");
+    result = dump(state);
+    fflush(stdout);
+  }
+  pcf_state_close(&state);
+
+  return result;
+}
@@ -173,7 +173,7 @@ foreach ($mergedComputers as $computer) {
 		echo "</br>";
 
 		$i = $i + 1;
-		echo "<font color='#0000b2'><a href=\"javascript:aktual('", $i, "')\">Show graph</a></font><br /><br />";
+		echo "<font color='#0000b2'><a href=\"javascript:showGraph('", $i, "', '", $computer->address, "')\">Show graph</a></font><br /><br />";
 		echo "<center>";
 		echo "<img id='", $i, "' src='graph/", $computer->address, ".svg' />";
 		echo "<img id='", $i, "' src='graph/javascript/", $computer->address, ".svg' />";
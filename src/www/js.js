@@ -33,6 +33,16 @@ function aktual(elem) {
   }
 }
 
+function showGraph(elem, address) {
+  aktual(elem);
+  if (document.getElementById(elem).style.display != "none") {
+    // pcf regenerates graphs of viewed computers first
+    var request = new XMLHttpRequest();
+    request.open("GET", "view_graph.php?address=" + encodeURIComponent(address), true);
+    request.send(null);
+  }
+}
+
 function saveCookies(n, v) {
   time = new Date();
   time.setTime(time.getTime() + 1000 * 3600 * 24);
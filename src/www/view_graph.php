@@ -0,0 +1,22 @@
+<?php
+
+# Remembers the hosts whose graphs are viewed, pcf regenerates them first
+$filename = "data/viewed";
+$limit = 16;
+
+$address = trim($_GET["address"]);
+if ($address == "" || strpbrk($address, "\r\n") !== false) {
+	exit();
+}
+
+$viewed = array();
+if (file_exists($filename)) {
+	$viewed = file($filename, FILE_IGNORE_NEW_LINES | FILE_SKIP_EMPTY_LINES);
+}
+$viewed = array_values(array_diff($viewed, array($address)));
+$viewed[] = $address;
+$viewed = array_slice($viewed, -$limit);
+
+file_put_contents($filename, implode("\n", $viewed) . "\n", LOCK_EX);
+
+?>